@@ -0,0 +1,244 @@
+#include "pch.h"
+#include "BenchSample.h"
+
+#include "../../../src/DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const uint32_t Rate = 48000;
+        const size_t PadFrames = 48;
+
+        // Each round times this many samples worth of chunks, prepared up front so only the operation counts.
+        const size_t BatchSamples = 1920000;
+        const int Rounds = 5;
+
+        const uint32_t ChannelCounts[] = {1, 2, 6, 8};
+        const size_t FrameCounts[] = {480, 4800, 48000};
+
+        const DspFormat Formats[] = {
+            DspFormat::Pcm8,
+            DspFormat::Pcm16,
+            DspFormat::Pcm24,
+            DspFormat::Pcm24in32,
+            DspFormat::Pcm32,
+            DspFormat::Float,
+            DspFormat::Double,
+        };
+
+        const char* GetFormatName(DspFormat format)
+        {
+            switch (format)
+            {
+                case DspFormat::Pcm8:      return "pcm8";
+                case DspFormat::Pcm16:     return "pcm16";
+                case DspFormat::Pcm24:     return "pcm24";
+                case DspFormat::Pcm24in32: return "pcm24in32";
+                case DspFormat::Pcm32:     return "pcm32";
+                case DspFormat::Float:     return "float";
+                case DspFormat::Double:    return "double";
+            }
+
+            return "unknown";
+        }
+
+        DWORD GetChannelMask(uint32_t channels)
+        {
+            switch (channels)
+            {
+                case 1: return KSAUDIO_SPEAKER_MONO;
+                case 2: return KSAUDIO_SPEAKER_STEREO;
+                case 6: return KSAUDIO_SPEAKER_5POINT1;
+                case 8: return KSAUDIO_SPEAKER_7POINT1_SURROUND;
+            }
+
+            assert(false);
+            return 0;
+        }
+
+        WAVEFORMATEXTENSIBLE BuildWaveFormat(DspFormat format, uint32_t channels)
+        {
+            const bool floating = (format == DspFormat::Float || format == DspFormat::Double);
+            const WORD bits = (WORD)(DspFormatSize(format) * 8);
+
+            WAVEFORMATEXTENSIBLE waveFormat = {};
+            waveFormat.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+            waveFormat.Format.nChannels = (WORD)channels;
+            waveFormat.Format.nSamplesPerSec = Rate;
+            waveFormat.Format.nBlockAlign = (WORD)(bits / 8 * channels);
+            waveFormat.Format.nAvgBytesPerSec = waveFormat.Format.nBlockAlign * Rate;
+            waveFormat.Format.wBitsPerSample = bits;
+            waveFormat.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+            waveFormat.Samples.wValidBitsPerSample = (format == DspFormat::Pcm24in32) ? 24 : bits;
+            waveFormat.dwChannelMask = GetChannelMask(channels);
+            waveFormat.SubFormat = floating ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT : KSDATAFORMAT_SUBTYPE_PCM;
+
+            assert(DspFormatFromWaveFormat(waveFormat.Format) == format);
+
+            return waveFormat;
+        }
+
+        DspChunk MakeFloatChunk(uint32_t channels, size_t frames)
+        {
+            return DspChunk(DspFormat::Float, channels, frames, Rate);
+        }
+
+        // Sample contents are noise below full scale, so that float sources don't hit clipping paths all the time.
+        std::unique_ptr<BenchSample> MakeSample(DspFormat format, uint32_t channels, size_t frames)
+        {
+            DspChunk noise = MakeFloatChunk(channels, frames);
+
+            std::mt19937 generator;
+            std::uniform_real_distribution<float> distribution(-0.9f, 0.9f);
+            float* pData = reinterpret_cast<float*>(noise.GetData());
+            std::generate(pData, pData + noise.GetSampleCount(), [&] { return distribution(generator); });
+
+            auto sample = std::make_unique<BenchSample>(frames * DspFormatSize(format) * channels);
+            DspChunk::ToBuffer(format, noise, frames, sample->GetData());
+
+            return sample;
+        }
+
+        // Best of the rounds, in nanoseconds per operation.
+        template <typename Prepare, typename Run>
+        double Measure(uint32_t channels, size_t frames, Prepare prepare, Run run)
+        {
+            const size_t count = std::max<size_t>(BatchSamples / (frames * channels), 4);
+            double best = std::numeric_limits<double>::max();
+
+            for (int round = 0; round < Rounds; round++)
+            {
+                std::vector<decltype(prepare())> items;
+                items.reserve(count);
+
+                for (size_t i = 0; i < count; i++)
+                    items.push_back(prepare());
+
+                const int64_t start = GetPerformanceCounter();
+
+                for (auto& item : items)
+                    run(item);
+
+                const int64_t end = GetPerformanceCounter();
+
+                best = std::min(best, (end - start) * 1000000000. / GetPerformanceFrequency() / count);
+            }
+
+            return best;
+        }
+
+        class Report final
+        {
+        public:
+
+            explicit Report(FILE* pFile) : m_file(pFile) {}
+
+            void Begin()
+            {
+                fprintf(m_file, "{\n  \"rate\": %u,\n  \"results\": [", Rate);
+            }
+
+            void End()
+            {
+                fprintf(m_file, "\n  ]\n}\n");
+            }
+
+            void Add(const char* op, DspFormat from, DspFormat to, uint32_t channels, size_t frames,
+                     double nanoseconds)
+            {
+                fprintf(m_file, "%s\n    {\"op\": \"%s\", \"from\": \"%s\", \"to\": \"%s\", \"channels\": %u, "
+                                "\"frames\": %u, \"ns\": %.1f, \"ns_per_sample\": %.4f}",
+                        m_empty ? "" : ",", op, GetFormatName(from), GetFormatName(to), channels, (uint32_t)frames,
+                        nanoseconds, nanoseconds / (frames * channels));
+                fflush(m_file);
+                m_empty = false;
+            }
+
+        private:
+
+            FILE* const m_file;
+            bool m_empty = true;
+        };
+
+        void Run(Report& report, uint32_t channels, size_t frames)
+        {
+            for (DspFormat from : Formats)
+            {
+                auto fromFormat = BuildWaveFormat(from, channels);
+                auto sample = MakeSample(from, channels, frames);
+                const auto props = sample->GetProperties();
+
+                for (DspFormat to : Formats)
+                {
+                    // Conversion out of a media sample, the first thing the renderer does to every input.
+                    report.Add("ToFormat", from, to, channels, frames,
+                               Measure(channels, frames,
+                                       [&] { return DspChunk(sample.get(), props, fromFormat.Format); },
+                                       [&](DspChunk& chunk) { DspChunk::ToFormat(to, chunk); }));
+                }
+            }
+
+            {
+                auto fromFormat = BuildWaveFormat(DspFormat::Float, channels);
+                auto sample = MakeSample(DspFormat::Float, channels, frames);
+                const auto props = sample->GetProperties();
+
+                report.Add("FreeMediaSample", DspFormat::Float, DspFormat::Float, channels, frames,
+                           Measure(channels, frames,
+                                   [&] { return DspChunk(sample.get(), props, fromFormat.Format); },
+                                   [](DspChunk& chunk) { chunk.FreeMediaSample(); }));
+            }
+
+            auto makeChunk = [&] { return MakeFloatChunk(channels, frames); };
+
+            typedef std::pair<DspChunk, DspChunk> ChunkPair;
+            report.Add("MergeChunks", DspFormat::Float, DspFormat::Float, channels, frames,
+                       Measure(channels, frames, [&] { return ChunkPair(makeChunk(), makeChunk()); },
+                               [](ChunkPair& chunks) { DspChunk::MergeChunks(chunks.first, chunks.second); }));
+
+            report.Add("PadHead", DspFormat::Float, DspFormat::Float, channels, frames,
+                       Measure(channels, frames, makeChunk, [](DspChunk& chunk) { chunk.PadHead(PadFrames); }));
+
+            report.Add("PadTail", DspFormat::Float, DspFormat::Float, channels, frames,
+                       Measure(channels, frames, makeChunk, [](DspChunk& chunk) { chunk.PadTail(PadFrames); }));
+
+            report.Add("ShrinkHead", DspFormat::Float, DspFormat::Float, channels, frames,
+                       Measure(channels, frames, makeChunk, [&](DspChunk& chunk) { chunk.ShrinkHead(frames / 2); }));
+
+            report.Add("ShrinkTail", DspFormat::Float, DspFormat::Float, channels, frames,
+                       Measure(channels, frames, makeChunk, [&](DspChunk& chunk) { chunk.ShrinkTail(frames / 2); }));
+        }
+
+        void Run(Report& report)
+        {
+            for (uint32_t channels : ChannelCounts)
+                for (size_t frames : FrameCounts)
+                    Run(report, channels, frames);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // Usage: sanear-bench [output.json], prints to the console otherwise.
+    FILE* pFile = stdout;
+
+    if (argc > 1 && fopen_s(&pFile, argv[1], "w") != 0)
+    {
+        fprintf(stderr, "can't open %s\n", argv[1]);
+        return 1;
+    }
+
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+    SaneAudioRenderer::Report report(pFile);
+    report.Begin();
+    SaneAudioRenderer::Run(report);
+    report.End();
+
+    if (pFile != stdout)
+        fclose(pFile);
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+    // Just enough of IMediaSample for DspChunk to hold on to. The benchmark owns the object,
+    // so reference counting never deletes it.
+    class BenchSample final
+        : public IMediaSample
+    {
+    public:
+
+        explicit BenchSample(size_t bytes) : m_data(bytes) {}
+        BenchSample(const BenchSample&) = delete;
+        BenchSample& operator=(const BenchSample&) = delete;
+
+        char* GetData() { return m_data.data(); }
+
+        AM_SAMPLE2_PROPERTIES GetProperties()
+        {
+            AM_SAMPLE2_PROPERTIES props = {};
+            props.cbData = sizeof(props);
+            props.pbBuffer = (BYTE*)m_data.data();
+            props.cbBuffer = props.lActual = (LONG)m_data.size();
+            return props;
+        }
+
+        STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override
+        {
+            if (!ppv)
+                return E_POINTER;
+
+            if (riid == IID_IUnknown || riid == IID_IMediaSample)
+            {
+                *ppv = static_cast<IMediaSample*>(this);
+                AddRef();
+                return S_OK;
+            }
+
+            *ppv = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        STDMETHODIMP_(ULONG) AddRef() override { return ++m_references; }
+        STDMETHODIMP_(ULONG) Release() override { return --m_references; }
+
+        STDMETHODIMP GetPointer(BYTE** ppBuffer) override { *ppBuffer = (BYTE*)m_data.data(); return S_OK; }
+        STDMETHODIMP_(long) GetSize() override { return (long)m_data.size(); }
+        STDMETHODIMP GetTime(REFERENCE_TIME*, REFERENCE_TIME*) override { return VFW_E_SAMPLE_TIME_NOT_SET; }
+        STDMETHODIMP SetTime(REFERENCE_TIME*, REFERENCE_TIME*) override { return E_NOTIMPL; }
+        STDMETHODIMP IsSyncPoint() override { return S_OK; }
+        STDMETHODIMP SetSyncPoint(BOOL) override { return E_NOTIMPL; }
+        STDMETHODIMP IsPreroll() override { return S_FALSE; }
+        STDMETHODIMP SetPreroll(BOOL) override { return E_NOTIMPL; }
+        STDMETHODIMP_(long) GetActualDataLength() override { return (long)m_data.size(); }
+        STDMETHODIMP SetActualDataLength(long) override { return E_NOTIMPL; }
+        STDMETHODIMP GetMediaType(AM_MEDIA_TYPE** ppMediaType) override { *ppMediaType = nullptr; return S_FALSE; }
+        STDMETHODIMP SetMediaType(AM_MEDIA_TYPE*) override { return E_NOTIMPL; }
+        STDMETHODIMP IsDiscontinuity() override { return S_FALSE; }
+        STDMETHODIMP SetDiscontinuity(BOOL) override { return E_NOTIMPL; }
+        STDMETHODIMP GetMediaTime(LONGLONG*, LONGLONG*) override { return VFW_E_MEDIA_TIME_NOT_SET; }
+        STDMETHODIMP SetMediaTime(LONGLONG*, LONGLONG*) override { return E_NOTIMPL; }
+
+    private:
+
+        std::vector<char> m_data;
+        ULONG m_references = 1;
+    };
+}
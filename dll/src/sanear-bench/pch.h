@@ -0,0 +1,7 @@
+#pragma once
+
+#include "../../../src/pch.h"
+
+#include <cstdio>
+#include <limits>
+#include <vector>
@@ -0,0 +1,173 @@
+#include "pch.h"
+#include "Test.h"
+
+#include "../sanear-bench/BenchSample.h"
+
+#include "../../../src/DspChunk.h"
+#include "../../../src/RingBuffer.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const uint32_t Channels = 2;
+        const uint32_t Rate = 48000;
+        const size_t SampleFrames = Rate / 100;
+        const size_t PeriodFrames = Rate / 100;
+        const size_t BufferPeriods = 4;
+        const size_t SampleCount = 10 * 60 * 100; // 10 minutes of 10ms samples.
+
+        // Source frames count up, so every played frame tells where in the timeline it came from.
+        int16_t GetSourceValue(size_t frame)
+        {
+            return (int16_t)(frame % 30000 + 1);
+        }
+
+        // Plays one period per wait out of a float buffer that the push loops keep full,
+        // like an exclusive mode device.
+        class SimulatedDevice final
+        {
+        public:
+
+            explicit SimulatedDevice(const std::vector<bool>& substituted)
+                : m_substituted(substituted)
+                , m_period(PeriodFrames * Channels)
+            {
+                m_buffer.Allocate(PeriodFrames * BufferPeriods, Channels * sizeof(float));
+            }
+
+            RingBuffer& GetBuffer() { return m_buffer; }
+
+            size_t GetPlayedFrames() const { return m_played; }
+            size_t GetMisplacedFrames() const { return m_misplaced; }
+
+            void Drain()
+            {
+                const size_t frames = m_buffer.Read((char*)m_period.data(), PeriodFrames);
+
+                for (size_t i = 0; i < frames; i++, m_played++)
+                {
+                    // Substituted samples have to come out as silence in their own place, everything else intact.
+                    const bool silent = m_substituted[m_played / SampleFrames];
+                    const float expected = silent ? 0.0f : GetSourceValue(m_played) / 32768.0f;
+
+                    for (uint32_t channel = 0; channel < Channels; channel++)
+                    {
+                        if (m_period[i * Channels + channel] != expected)
+                        {
+                            m_misplaced++;
+                            break;
+                        }
+                    }
+                }
+            }
+
+        private:
+
+            const std::vector<bool>& m_substituted;
+            RingBuffer m_buffer;
+            std::vector<float> m_period;
+            size_t m_played = 0;
+            size_t m_misplaced = 0;
+        };
+
+    #ifndef NDEBUG
+        bool Run(uint32_t failureInterval)
+        {
+            std::vector<bool> substituted(SampleCount);
+            SimulatedDevice device(substituted);
+
+            BenchSample sample(SampleFrames * Channels * sizeof(int16_t));
+            const auto props = sample.GetProperties();
+
+            WAVEFORMATEX format = {};
+            format.wFormatTag = WAVE_FORMAT_PCM;
+            format.nChannels = Channels;
+            format.nSamplesPerSec = Rate;
+            format.wBitsPerSample = 16;
+            format.nBlockAlign = Channels * 2;
+            format.nAvgBytesPerSec = format.nBlockAlign * Rate;
+
+            size_t substitutions = 0;
+
+            DspChunkPool::SetFailureInterval(failureInterval);
+
+            for (size_t n = 0; n < SampleCount; n++)
+            {
+                int16_t* pData = reinterpret_cast<int16_t*>(sample.GetData());
+                for (size_t i = 0; i < SampleFrames; i++)
+                    for (uint32_t channel = 0; channel < Channels; channel++)
+                        pData[i * Channels + channel] = GetSourceValue(n * SampleFrames + i);
+
+                DspChunk chunk;
+                size_t silenceFrames = 0;
+
+                try
+                {
+                    // The first thing the dsp chain does to every sample.
+                    chunk = DspChunk(&sample, props, format);
+                    DspChunk::ToFloat(chunk);
+                }
+                catch (std::bad_alloc&)
+                {
+                    // Same substitution as AudioRenderer::Push().
+                    chunk = DspChunk();
+                    silenceFrames = SampleFrames;
+                    substituted[n] = true;
+                    substitutions++;
+                }
+
+                // Same loops as AudioRenderer::PushSilenceToDevice() and PushToDevice(),
+                // with the device playing a period on each wait.
+                while (silenceFrames > 0)
+                {
+                    silenceFrames -= device.GetBuffer().WriteSilence(silenceFrames);
+
+                    if (silenceFrames > 0)
+                        device.Drain();
+                }
+
+                while (!chunk.IsEmpty())
+                {
+                    device.GetBuffer().Write(chunk, DspFormat::Float);
+
+                    if (!chunk.IsEmpty())
+                        device.Drain();
+                }
+            }
+
+            DspChunkPool::SetFailureInterval(0);
+
+            while (!device.GetBuffer().IsEmpty())
+                device.Drain();
+
+            const size_t pushedFrames = SampleCount * SampleFrames;
+
+            printf("  failure interval %u: %u of %u samples substituted, %u frames pushed, "
+                   "%u played, %u off the timeline\n",
+                   failureInterval, (uint32_t)substitutions, (uint32_t)SampleCount, (uint32_t)pushedFrames,
+                   (uint32_t)device.GetPlayedFrames(), (uint32_t)device.GetMisplacedFrames());
+
+            return device.GetPlayedFrames() == pushedFrames &&
+                   device.GetMisplacedFrames() == 0 &&
+                   (substitutions > 0) == (failureInterval > 0);
+        }
+    #endif
+    }
+
+    bool TestFaultInjection()
+    {
+    #ifndef NDEBUG
+        bool passed = true;
+
+        // No failures as a baseline, then every 7th allocation, then all of them.
+        for (uint32_t failureInterval : {0, 7, 1})
+            passed = Run(failureInterval) && passed;
+
+        return passed;
+    #else
+        printf("  skipped, DspChunkPool::SetFailureInterval() exists in debug builds only\n");
+        return true;
+    #endif
+    }
+}
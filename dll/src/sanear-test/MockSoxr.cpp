@@ -0,0 +1,273 @@
+#include "pch.h"
+#include "MockSoxr.h"
+
+#include <soxr.h>
+
+namespace
+{
+    const double Pi = 3.14159265358979323846;
+
+    // Kernel half-width in zero crossings of the lower of the two rates, and its Kaiser window shape.
+    const int ZeroCrossings = 16;
+    const double KaiserBeta = 10.0;
+
+    std::atomic<uint32_t> variableInstances(0);
+    std::atomic<uint32_t> ratioChanges(0);
+
+    double BesselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; term > sum * 1e-17; k++)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+}
+
+struct soxr
+{
+    bool variable = false;
+    uint64_t inputRate = 0;
+    uint64_t outputRate = 0;
+    unsigned channels = 0;
+
+    double ratio = 0.0; // Input frames per output frame.
+    double slewStep = 0.0;
+    size_t slewFrames = 0;
+
+    // Lowpass scale and half-width in input frames, fixed once processing starts.
+    double scale = 0.0;
+    int halfWidth = 0;
+
+    std::vector<float> input; // Interleaved, starts at input frame inputBase.
+    uint64_t inputBase = 0;
+    uint64_t inputFrames = 0;
+    bool flushing = false;
+
+    uint64_t outputFrames = 0;
+    double position = 0.0; // Input position of the next output frame, variable rate only.
+
+    std::vector<double> sums;
+
+    double GetPosition() const
+    {
+        if (variable)
+            return position;
+
+        // Whole and fractional parts separately, so the position stays exact for long streams.
+        const uint64_t product = outputFrames * inputRate;
+        return (double)(product / outputRate) + (double)(product % outputRate) / outputRate;
+    }
+
+    bool IsReady() const
+    {
+        const double t = GetPosition();
+
+        if (flushing)
+            return t < inputFrames;
+
+        return (uint64_t)std::floor(t) + halfWidth < inputFrames;
+    }
+
+    double Kernel(double distance) const
+    {
+        const double x = distance / halfWidth;
+
+        if (x <= -1.0 || x >= 1.0)
+            return 0.0;
+
+        // Kaiser window with the pedestal taken off, so taps fade out to zero at the edges.
+        // Variable rate positions land a hair off whole frames, and a step there would show.
+        const double window = (BesselI0(KaiserBeta * std::sqrt(1.0 - x * x)) - 1.0) / (BesselI0(KaiserBeta) - 1.0);
+        const double phase = Pi * scale * distance;
+
+        return scale * window * (phase == 0.0 ? 1.0 : std::sin(phase) / phase);
+    }
+
+    void Render(float* pOutput)
+    {
+        const double t = GetPosition();
+        const int64_t first = (int64_t)std::floor(t) - halfWidth + 1;
+        const int64_t last = (int64_t)std::floor(t) + halfWidth;
+
+        sums.assign(channels, 0.0);
+
+        // Zeros before the stream and past its end.
+        for (int64_t j = std::max<int64_t>(first, 0); j <= last && j < (int64_t)inputFrames; j++)
+        {
+            const double weight = Kernel(t - j);
+            const float* pFrame = input.data() + (size_t)(j - inputBase) * channels;
+
+            for (unsigned channel = 0; channel < channels; channel++)
+                sums[channel] += pFrame[channel] * weight;
+        }
+
+        for (unsigned channel = 0; channel < channels; channel++)
+            pOutput[channel] = (float)sums[channel];
+
+        outputFrames++;
+
+        if (variable)
+        {
+            position += ratio;
+
+            if (slewFrames > 0)
+            {
+                ratio += slewStep;
+                slewFrames--;
+            }
+        }
+    }
+
+    void Trim()
+    {
+        const int64_t keep = (int64_t)std::floor(GetPosition()) - halfWidth;
+
+        if (keep > (int64_t)inputBase + 65536)
+        {
+            input.erase(input.begin(), input.begin() + (size_t)(keep - inputBase) * channels);
+            inputBase = keep;
+        }
+    }
+};
+
+soxr_t soxr_create(double input_rate, double output_rate, unsigned num_channels, soxr_error_t* error,
+                   soxr_io_spec_t const* io_spec, soxr_quality_spec_t const* q_spec, soxr_runtime_spec_t const*)
+{
+    assert(io_spec && io_spec->itype == SOXR_FLOAT32_I && io_spec->otype == SOXR_FLOAT32_I);
+
+    soxr_t resampler = new soxr;
+    resampler->variable = q_spec && (q_spec->flags & SOXR_VR);
+    resampler->inputRate = (uint64_t)input_rate;
+    resampler->outputRate = (uint64_t)output_rate;
+    resampler->channels = num_channels;
+    resampler->ratio = input_rate / output_rate;
+
+    if (resampler->variable)
+        variableInstances++;
+
+    if (error)
+        *error = nullptr;
+
+    return resampler;
+}
+
+soxr_error_t soxr_process(soxr_t resampler, soxr_in_t in, size_t ilen, size_t* idone,
+                          soxr_out_t out, size_t olen, size_t* odone)
+{
+    if (resampler->halfWidth == 0)
+    {
+        // Variable instances get the filter of the ratio they start at.
+        resampler->scale = std::min(1.0, 1.0 / resampler->ratio);
+        resampler->halfWidth = (int)std::ceil(ZeroCrossings / resampler->scale);
+    }
+
+    if (in)
+    {
+        const float* pInput = (const float*)in;
+        resampler->input.insert(resampler->input.end(), pInput, pInput + ilen * resampler->channels);
+        resampler->inputFrames += ilen;
+    }
+    else
+    {
+        resampler->flushing = true;
+    }
+
+    size_t done = 0;
+
+    for (float* pOutput = (float*)out; done < olen && resampler->IsReady(); done++)
+        resampler->Render(pOutput + done * resampler->channels);
+
+    resampler->Trim();
+
+    if (idone)
+        *idone = in ? ilen : 0;
+
+    if (odone)
+        *odone = done;
+
+    return nullptr;
+}
+
+soxr_error_t soxr_set_io_ratio(soxr_t resampler, double io_ratio, size_t slew_len)
+{
+    assert(resampler->variable);
+
+    if (resampler->halfWidth != 0 && io_ratio != resampler->ratio)
+        ratioChanges++;
+
+    if (slew_len == 0)
+    {
+        resampler->ratio = io_ratio;
+        resampler->slewFrames = 0;
+    }
+    else
+    {
+        resampler->slewStep = (io_ratio - resampler->ratio) / slew_len;
+        resampler->slewFrames = slew_len;
+    }
+
+    return nullptr;
+}
+
+double soxr_delay(soxr_t resampler)
+{
+    // In output frames, like the real one.
+    return std::max(0.0, (resampler->inputFrames - resampler->GetPosition()) / resampler->ratio);
+}
+
+soxr_error_t soxr_clear(soxr_t resampler)
+{
+    soxr fresh;
+    fresh.variable = resampler->variable;
+    fresh.inputRate = resampler->inputRate;
+    fresh.outputRate = resampler->outputRate;
+    fresh.channels = resampler->channels;
+    fresh.ratio = resampler->ratio;
+    *resampler = std::move(fresh);
+
+    return nullptr;
+}
+
+void soxr_delete(soxr_t resampler)
+{
+    delete resampler;
+}
+
+soxr_io_spec_t soxr_io_spec(soxr_datatype_t itype, soxr_datatype_t otype)
+{
+    soxr_io_spec_t spec = {};
+    spec.itype = itype;
+    spec.otype = otype;
+    spec.scale = 1.0;
+    return spec;
+}
+
+soxr_quality_spec_t soxr_quality_spec(unsigned long, unsigned long flags)
+{
+    soxr_quality_spec_t spec = {};
+    spec.flags = flags;
+    return spec;
+}
+
+soxr_runtime_spec_t soxr_runtime_spec(unsigned num_threads)
+{
+    soxr_runtime_spec_t spec = {};
+    spec.num_threads = num_threads;
+    return spec;
+}
+
+namespace SaneAudioRenderer
+{
+    MockSoxrCounters GetMockSoxrCounters()
+    {
+        MockSoxrCounters counters;
+        counters.variableInstances = variableInstances;
+        counters.ratioChanges = ratioChanges;
+        return counters;
+    }
+}
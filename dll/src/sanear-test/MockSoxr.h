@@ -0,0 +1,15 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+    // The test project links MockSoxr.cpp in place of soxr, a plain windowed-sinc resampler behind the same api.
+    // Constant rate instances put output frame k at input position exactly k * inputRate / outputRate,
+    // variable rate ones step through the input by the io ratio.
+    struct MockSoxrCounters
+    {
+        uint32_t variableInstances = 0;
+        uint32_t ratioChanges = 0; // Made after a variable instance started processing.
+    };
+
+    MockSoxrCounters GetMockSoxrCounters();
+}
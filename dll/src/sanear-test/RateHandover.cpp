@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "Test.h"
+#include "MockSoxr.h"
+
+#include "../../../src/DspRate.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const double Pi = 3.14159265358979323846;
+
+        const uint32_t Channels = 2;
+        const double ToneFrequency = 1000.0;
+        const double ToneAmplitude = 0.5;
+
+        struct HandoverCase
+        {
+            uint32_t inputRate;
+            uint32_t outputRate;
+            double maxErrorDb;
+        };
+
+        // Rate pairs with a short period hand over on a common frame of both grids. 44.1k->47999 falls back
+        // to aligning on input frames only, and the leftover sub-frame offset shows on a 1kHz tone.
+        const HandoverCase Cases[] = {
+            {44100, 48000, -120.0},
+            {48000, 44100, -120.0},
+            {44100, 96000, -120.0},
+            {44100, 47999, -20.0},
+        };
+
+        const uint32_t ChunkMilliseconds[] = {10, 23, 100};
+
+        DspChunk MakeTone(uint32_t rate, uint64_t firstFrame, size_t frames)
+        {
+            DspChunk chunk(DspFormat::Float, Channels, frames, rate);
+            float* pData = reinterpret_cast<float*>(chunk.GetData());
+
+            for (size_t i = 0; i < frames; i++)
+            {
+                const double phase = 2.0 * Pi * ToneFrequency * (firstFrame + i) / rate;
+
+                for (uint32_t channel = 0; channel < Channels; channel++)
+                    pData[i * Channels + channel] = (float)(ToneAmplitude * std::sin(phase));
+            }
+
+            return chunk;
+        }
+
+        void Append(std::vector<float>& output, DspChunk& chunk)
+        {
+            if (chunk.IsEmpty())
+                return;
+
+            assert(chunk.GetFormat() == DspFormat::Float);
+            const float* pData = reinterpret_cast<const float*>(chunk.GetData());
+            output.insert(output.end(), pData, pData + chunk.GetSampleCount());
+        }
+
+        // Two streams of the same tone, one stays on constant rate conversion and the other switches
+        // to variable rate 200ms in without any actual correction. Until the variable resampler gets
+        // its first ratio update the outputs should be the same, so the peak difference over that span
+        // is what the handover itself leaves behind.
+        bool Run(const HandoverCase& test, uint32_t chunkMilliseconds)
+        {
+            const size_t chunkFrames = test.inputRate * chunkMilliseconds / 1000;
+            const size_t switchChunk = 200 / chunkMilliseconds;
+            const size_t lastChunk = switchChunk + 1000 / chunkMilliseconds;
+
+            DspRate constant, switching;
+            constant.Initialize(false, test.inputRate, test.outputRate, Channels, false, 1.0);
+            switching.Initialize(false, test.inputRate, test.outputRate, Channels, false, 1.0);
+
+            const MockSoxrCounters before = GetMockSoxrCounters();
+
+            std::vector<float> constantOutput, switchingOutput;
+
+            for (size_t n = 0; n <= lastChunk; n++)
+            {
+                if (n == switchChunk)
+                    switching.Adjust(0);
+
+                DspChunk constantChunk = MakeTone(test.inputRate, n * chunkFrames, chunkFrames);
+                DspChunk switchingChunk = MakeTone(test.inputRate, n * chunkFrames, chunkFrames);
+
+                constant.Process(constantChunk);
+                switching.Process(switchingChunk);
+
+                // Rate control went to work, the streams are supposed to differ from here on.
+                if (GetMockSoxrCounters().ratioChanges != before.ratioChanges)
+                    break;
+
+                Append(constantOutput, constantChunk);
+                Append(switchingOutput, switchingChunk);
+            }
+
+            const MockSoxrCounters after = GetMockSoxrCounters();
+
+            const size_t samples = std::min(constantOutput.size(), switchingOutput.size());
+
+            double peak = 0.0;
+            for (size_t i = 0; i < samples; i++)
+                peak = std::max(peak, (double)std::abs(constantOutput[i] - switchingOutput[i]));
+
+            const double peakDb = 20.0 * std::log10(std::max(peak, 1e-20));
+
+            // The frames that get compared have to cover the handover, otherwise there is nothing to measure.
+            const size_t switchOutputFrames = (size_t)((uint64_t)switchChunk * chunkFrames *
+                                                       test.outputRate / test.inputRate);
+            const size_t comparedFrames = samples / Channels;
+            const bool handedOver = (after.variableInstances == before.variableInstances + 1) &&
+                                    comparedFrames > switchOutputFrames + chunkFrames;
+
+            printf("  %u->%u, %ums chunks: peak error %.1fdB over %u frames, %d frames apart%s\n",
+                   test.inputRate, test.outputRate, chunkMilliseconds, peakDb, (uint32_t)comparedFrames,
+                   (int)((int64_t)switchingOutput.size() / Channels - (int64_t)constantOutput.size() / Channels),
+                   handedOver ? "" : ", no handover");
+
+            return handedOver && peakDb <= test.maxErrorDb;
+        }
+    }
+
+    bool TestRateHandover()
+    {
+        bool passed = true;
+
+        for (const auto& test : Cases)
+            for (uint32_t chunkMilliseconds : ChunkMilliseconds)
+                passed = Run(test, chunkMilliseconds) && passed;
+
+        return passed;
+    }
+}
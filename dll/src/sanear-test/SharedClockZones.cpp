@@ -0,0 +1,457 @@
+#include "pch.h"
+#include "Test.h"
+
+#include "../../../src/DspRate.h"
+#include "../../../src/SharedClock.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const uint32_t Channels = 2;
+        const uint32_t InputRate = 44100;
+        const uint32_t DeviceRate = 48000;
+        const size_t ChunkFrames = InputRate / 10;
+        const REFERENCE_TIME DeviceBuffer = 200 * OneMillisecond; // Renderer default.
+        const REFERENCE_TIME StreamLatency = 10 * OneMillisecond;
+
+        const REFERENCE_TIME Duration = 10 * OneSecond;
+        const REFERENCE_TIME TickPeriod = 10 * OneMillisecond;
+        const size_t Ticks = (size_t)(Duration / TickPeriod);
+        const REFERENCE_TIME SettleTime = 2 * OneSecond;
+        const REFERENCE_TIME MaxSharedSkew = OneMillisecond;
+
+        // Input frame count is written into the stream itself, channel 0 counts within a block and channel 1
+        // counts blocks. Both stay small, so resampling doesn't blur them past a fraction of a frame.
+        const uint32_t CountBlock = 4096;
+        const float CountMargin = 32.0f;
+
+        struct Zone
+        {
+            double ppm;
+            REFERENCE_TIME startDelay;
+        };
+
+        const size_t ZoneCount = 3;
+        const Zone Zones[ZoneCount] = {
+            {0.0,   0},
+            {120.0, 37 * OneMillisecond},
+            {-90.0, 81 * OneMillisecond},
+        };
+
+        // Lives in a file mapping named after the parent process, zone processes fill in their rows.
+        struct Results
+        {
+            int64_t epoch; // Counter time of the first tick, zones start their delay after it.
+            REFERENCE_TIME played[ZoneCount][Ticks]; // Stream position audible at each tick, -1 if unknown.
+        };
+
+        class ResultsMapping final
+        {
+        public:
+
+            ResultsMapping(DWORD parentProcessId)
+            {
+                std::array<wchar_t, 64> name;
+                if (swprintf(name.data(), name.size(), L"Local\\SaneAudioRenderer.SharedClockTest.%u",
+                             parentProcessId) < 0)
+                {
+                    return;
+                }
+
+                m_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                              0, sizeof(Results), name.data());
+
+                if (m_mapping != NULL)
+                    m_pResults = static_cast<Results*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS,
+                                                                     0, 0, sizeof(Results)));
+            }
+
+            ResultsMapping(const ResultsMapping&) = delete;
+            ResultsMapping& operator=(const ResultsMapping&) = delete;
+
+            ~ResultsMapping()
+            {
+                if (m_pResults)
+                    UnmapViewOfFile(m_pResults);
+
+                if (m_mapping != NULL)
+                    CloseHandle(m_mapping);
+            }
+
+            Results* Get() const { return m_pResults; }
+
+        private:
+
+            HANDLE m_mapping = NULL;
+            Results* m_pResults = nullptr;
+        };
+
+        // Plays from the moment it's started at its own crystal rate, ppm off the performance counter.
+        // Everything pushed is kept, the audible frame at each tick gets decoded after the run.
+        class SimulatedDevice final
+        {
+        public:
+
+            SimulatedDevice(double ppm, int64_t startTime)
+                : m_speed(1.0 + ppm * 1e-6)
+                , m_startTime(startTime)
+            {
+            }
+
+            int64_t GetPlayedFrames(int64_t counterTime) const
+            {
+                if (counterTime <= m_startTime)
+                    return 0;
+
+                return (int64_t)((counterTime - m_startTime) * m_speed * DeviceRate / OneSecond);
+            }
+
+            // In device clock, what the audio clock of the renderer is built on.
+            REFERENCE_TIME GetPosition(int64_t counterTime) const
+            {
+                return FramesToTimeLong(GetPlayedFrames(counterTime), DeviceRate);
+            }
+
+            REFERENCE_TIME GetEnd() const
+            {
+                return FramesToTimeLong(m_output.size() / Channels, DeviceRate);
+            }
+
+            // Silence counts toward the position, like it does with a real device.
+            REFERENCE_TIME GetSilence() const
+            {
+                return FramesToTimeLong(m_silenceFrames, DeviceRate);
+            }
+
+            // Whatever the device ran out of in the meantime has been played as silence.
+            void Push(DspChunk& chunk, int64_t counterTime)
+            {
+                const int64_t missingFrames = GetPlayedFrames(counterTime) - (int64_t)(m_output.size() / Channels);
+
+                if (missingFrames > 0)
+                {
+                    m_output.resize(m_output.size() + (size_t)missingFrames * Channels);
+                    m_silenceFrames += missingFrames;
+                }
+
+                if (chunk.IsEmpty())
+                    return;
+
+                assert(chunk.GetFormat() == DspFormat::Float);
+                const float* pData = reinterpret_cast<const float*>(chunk.GetData());
+                m_output.insert(m_output.end(), pData, pData + chunk.GetSampleCount());
+            }
+
+            // Stream position of the input frame heard at the given device frame, -1 when the count can't be read
+            // there (silence, or resampler ringing around a block boundary). Reads the nearest clean frame ahead,
+            // one that sits well inside a block and steps to the next frame by about the resampling ratio.
+            REFERENCE_TIME Decode(int64_t frame) const
+            {
+                const int64_t frames = (int64_t)(m_output.size() / Channels);
+                const float step = (float)InputRate / DeviceRate;
+
+                for (int64_t i = frame; i >= 0 && i + 1 < frames && i < frame + 256; i++)
+                {
+                    const float low = m_output[(size_t)i * Channels];
+                    const float high = m_output[(size_t)i * Channels + 1];
+                    const float nextLow = m_output[(size_t)(i + 1) * Channels];
+
+                    if (low > CountMargin && low < CountBlock - CountMargin &&
+                        std::abs(nextLow - low - step) < 0.01f &&
+                        high > -0.01f && std::abs(high - std::round(high)) < 0.01f)
+                    {
+                        const double inputFrame = std::round(high) * CountBlock + low - (double)(i - frame) * step;
+
+                        return (REFERENCE_TIME)(inputFrame * OneSecond / InputRate);
+                    }
+                }
+
+                return -1;
+            }
+
+        private:
+
+            const double m_speed;
+            const int64_t m_startTime;
+            std::vector<float> m_output;
+            int64_t m_silenceFrames = 0;
+        };
+
+        DspChunk MakeCountedChunk(uint64_t firstFrame)
+        {
+            DspChunk chunk(DspFormat::Float, Channels, ChunkFrames, InputRate);
+            float* pData = reinterpret_cast<float*>(chunk.GetData());
+
+            for (size_t i = 0; i < ChunkFrames; i++)
+            {
+                pData[i * Channels] = (float)((firstFrame + i) % CountBlock);
+                pData[i * Channels + 1] = (float)((firstFrame + i) / CountBlock);
+            }
+
+            return chunk;
+        }
+
+        // Same decisions as the clock matching branch of AudioRenderer::ApplyRateCorrection(),
+        // with the domain master's stream position in place of the graph clock.
+        void MatchClock(SimulatedDevice& device, DspRate& rate, REFERENCE_TIME& clockOffset,
+                        REFERENCE_TIME myTime, REFERENCE_TIME masterTime, int64_t counterTime, DspChunk& chunk)
+        {
+            const REFERENCE_TIME latency = StreamLatency * 2;
+            const REFERENCE_TIME remaining = device.GetEnd() - device.GetPosition(counterTime);
+
+            if (myTime > masterTime)
+            {
+                REFERENCE_TIME padTime = myTime - masterTime;
+                size_t padFrames = TimeToFrames(padTime, DeviceRate);
+
+                if (padFrames > DeviceRate / 33)
+                {
+                    chunk.PadHead(padFrames);
+
+                    const REFERENCE_TIME paddedTime = FramesToTime(padFrames, DeviceRate);
+                    clockOffset -= paddedTime;
+                    padTime -= paddedTime;
+                }
+
+                rate.Adjust(padTime);
+                clockOffset -= padTime;
+            }
+            else if (remaining > latency)
+            {
+                REFERENCE_TIME dropTime = std::min(masterTime - myTime, remaining - latency);
+                size_t dropFrames = std::min(TimeToFrames(dropTime, DeviceRate), chunk.GetFrameCount());
+
+                if (dropFrames > DeviceRate / 33)
+                {
+                    chunk.ShrinkHead(chunk.GetFrameCount() - dropFrames);
+
+                    const REFERENCE_TIME droppedTime = FramesToTime(dropFrames, DeviceRate);
+                    clockOffset += droppedTime;
+                    dropTime -= droppedTime;
+                }
+
+                rate.Adjust(-dropTime);
+                clockOffset += dropTime;
+            }
+        }
+
+        void WaitUntil(int64_t counterTime)
+        {
+            while (SharedClock::GetCounterTime() < counterTime)
+                Sleep(1);
+        }
+
+        // One zone, the part of the renderer between the source and the device. Zones in a domain publish
+        // or follow through SharedClock the way AudioRenderer does, domain 0 leaves them free running.
+        bool RunZone(size_t zone, UINT32 domain, Results& results)
+        {
+            const int64_t startTime = results.epoch + Zones[zone].startDelay;
+
+            SimulatedDevice device(Zones[zone].ppm, startTime);
+            DspRate rate;
+            rate.Initialize(false, InputRate, DeviceRate, Channels, false, 1.0);
+
+            SharedClock sharedClock;
+            REFERENCE_TIME clockOffset = 0; // What OffsetAudioClock() would have accumulated.
+            uint64_t inputFrames = 0;
+
+            auto fill = [&]
+            {
+                for (int64_t now = SharedClock::GetCounterTime();
+                     device.GetEnd() - device.GetPosition(now) < DeviceBuffer;
+                     now = SharedClock::GetCounterTime())
+                {
+                    DspChunk chunk = MakeCountedChunk(inputFrames);
+                    inputFrames += ChunkFrames;
+
+                    rate.Process(chunk);
+
+                    now = SharedClock::GetCounterTime();
+                    const REFERENCE_TIME myTime = device.GetPosition(now) - device.GetSilence() + clockOffset;
+
+                    if (device.GetPlayedFrames(now) > 0)
+                    {
+                        REFERENCE_TIME masterTime;
+
+                        if (sharedClock.IsMaster())
+                        {
+                            sharedClock.Publish(myTime);
+                        }
+                        else if (sharedClock.GetStreamTime(masterTime))
+                        {
+                            MatchClock(device, rate, clockOffset, myTime, masterTime, now, chunk);
+                        }
+                    }
+
+                    device.Push(chunk, now);
+                }
+            };
+
+            // The device starts with a full buffer, like it does after the renderer has been paused.
+            fill();
+            WaitUntil(startTime);
+
+            // Zones join in start order, the first one has to end up publishing.
+            sharedClock.Join(domain);
+
+            if (domain != 0 && sharedClock.IsMaster() != (zone == 0))
+                return false;
+
+            std::vector<int64_t> tickFrames(Ticks, -1);
+
+            for (size_t tick = 0; tick < Ticks;)
+            {
+                const int64_t now = SharedClock::GetCounterTime();
+
+                // Ticks the device has run dry on stay unknown.
+                for (; tick < Ticks && results.epoch + (int64_t)tick * TickPeriod <= now; tick++)
+                {
+                    const int64_t tickTime = results.epoch + tick * TickPeriod;
+
+                    if (tickTime > startTime && device.GetPosition(tickTime) < device.GetEnd())
+                        tickFrames[tick] = device.GetPlayedFrames(tickTime);
+                }
+
+                fill();
+                Sleep(2);
+            }
+
+            for (size_t tick = 0; tick < Ticks; tick++)
+                results.played[zone][tick] = (tickFrames[tick] < 0) ? -1 : device.Decode(tickFrames[tick]);
+
+            return true;
+        }
+
+        bool SpawnZones(const std::wstring& path, DWORD processId, UINT32 domain)
+        {
+            std::array<PROCESS_INFORMATION, ZoneCount> processes = {};
+            bool passed = true;
+
+            for (size_t zone = 0; zone < ZoneCount; zone++)
+            {
+                std::wstring commandLine = L"\"" + path + L"\" SharedClockZone " + std::to_wstring(processId) +
+                                           L" " + std::to_wstring(zone) + L" " + std::to_wstring(domain);
+
+                STARTUPINFOW startupInfo = {sizeof(startupInfo)};
+
+                if (!CreateProcessW(path.c_str(), &commandLine[0], nullptr, nullptr, FALSE, 0,
+                                    nullptr, nullptr, &startupInfo, &processes[zone]))
+                {
+                    printf("  failed to start zone %u\n", (uint32_t)zone);
+                    passed = false;
+                }
+            }
+
+            for (auto& process : processes)
+            {
+                if (process.hProcess == NULL)
+                    continue;
+
+                DWORD exitCode = 1;
+                WaitForSingleObject(process.hProcess, INFINITE);
+                GetExitCodeProcess(process.hProcess, &exitCode);
+
+                passed = (exitCode == 0) && passed;
+
+                CloseHandle(process.hThread);
+                CloseHandle(process.hProcess);
+            }
+
+            return passed;
+        }
+
+        // Skew of every zone against the first one, at the end and the worst of it once settled.
+        bool Report(const char* name, const Results& results, bool shared)
+        {
+            bool passed = true;
+
+            for (size_t zone = 1; zone < ZoneCount; zone++)
+            {
+                REFERENCE_TIME finalSkew = 0, maxSettledSkew = 0;
+                size_t unknownTicks = 0;
+
+                for (size_t tick = 0; tick < Ticks; tick++)
+                {
+                    const REFERENCE_TIME master = results.played[0][tick];
+                    const REFERENCE_TIME follower = results.played[zone][tick];
+
+                    if ((int64_t)tick * TickPeriod < Zones[zone].startDelay + SettleTime)
+                        continue;
+
+                    if (master < 0 || follower < 0)
+                    {
+                        unknownTicks++;
+                        continue;
+                    }
+
+                    finalSkew = follower - master;
+                    maxSettledSkew = std::max(maxSettledSkew, std::abs(finalSkew));
+                }
+
+                printf("  %s, zone %u (%+.0f ppm, started %u ms late): final skew %.2f ms,"
+                       " max %.2f ms after %u s, %u ticks unreadable\n", name, (uint32_t)zone, Zones[zone].ppm,
+                       (uint32_t)(Zones[zone].startDelay / OneMillisecond), finalSkew / (double)OneMillisecond,
+                       maxSettledSkew / (double)OneMillisecond, (uint32_t)(SettleTime / OneSecond),
+                       (uint32_t)unknownTicks);
+
+                // Free running zones keep their start offsets, which makes sure the measurement sees skew at all.
+                if (shared)
+                    passed = maxSettledSkew < MaxSharedSkew && unknownTicks == 0 && passed;
+                else
+                    passed = std::abs(finalSkew) > Zones[zone].startDelay / 2 && passed;
+            }
+
+            return passed;
+        }
+    }
+
+    bool TestSharedClock()
+    {
+        const DWORD processId = GetCurrentProcessId();
+
+        ResultsMapping mapping(processId);
+        Results* pResults = mapping.Get();
+
+        std::array<wchar_t, MAX_PATH> path;
+        if (!pResults || GetModuleFileNameW(NULL, path.data(), (DWORD)path.size()) == 0)
+            return false;
+
+        // Own process id keeps the domain clear of real renderers and of concurrent test runs.
+        const UINT32 domains[] = {0, processId | 0x80000000};
+        const char* names[] = {"free running", "shared domain"};
+
+        bool passed = true;
+
+        for (size_t run = 0; run < 2; run++)
+        {
+            // Leaves time for the zone processes to start up before the first tick.
+            pResults->epoch = SharedClock::GetCounterTime() + OneSecond;
+
+            for (auto& row : pResults->played)
+                std::fill(std::begin(row), std::end(row), -1);
+
+            passed = SpawnZones(path.data(), processId, domains[run]) &&
+                     Report(names[run], *pResults, domains[run] != 0) && passed;
+        }
+
+        return passed;
+    }
+
+    int RunSharedClockZone(int argc, char* argv[])
+    {
+        if (argc != 3)
+            return 1;
+
+        const DWORD parentProcessId = strtoul(argv[0], nullptr, 10);
+        const size_t zone = strtoul(argv[1], nullptr, 10);
+        const UINT32 domain = strtoul(argv[2], nullptr, 10);
+
+        ResultsMapping mapping(parentProcessId);
+
+        if (!mapping.Get() || zone >= ZoneCount)
+            return 1;
+
+        return RunZone(zone, domain, *mapping.Get()) ? 0 : 1;
+    }
+}
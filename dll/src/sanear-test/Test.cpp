@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "Test.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        struct TestEntry
+        {
+            const char* name;
+            bool(*function)();
+        };
+
+        const TestEntry Tests[] = {
+            {"FaultInjection", TestFaultInjection},
+            {"RateHandover", TestRateHandover},
+            {"SharedClock", TestSharedClock},
+            {"TimeAccounting", TestTimeAccounting},
+        };
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // Usage: sanear-test [name], runs every test otherwise. Exit code is the number of failed tests.
+    const char* pFilter = (argc > 1) ? argv[1] : nullptr;
+
+    if (pFilter && strcmp(pFilter, "SharedClockZone") == 0)
+        return SaneAudioRenderer::RunSharedClockZone(argc - 2, argv + 2);
+
+    int failures = 0;
+
+    for (const auto& test : SaneAudioRenderer::Tests)
+    {
+        if (pFilter && strcmp(pFilter, test.name) != 0)
+            continue;
+
+        printf("%s\n", test.name);
+        fflush(stdout);
+
+        const bool passed = test.function();
+        printf("%s %s\n\n", test.name, passed ? "passed" : "FAILED");
+        fflush(stdout);
+
+        if (!passed)
+            failures++;
+    }
+
+    return failures;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+    // Each test prints what it measured and returns false when the result is off.
+    bool TestFaultInjection();
+    bool TestRateHandover();
+    bool TestSharedClock();
+    bool TestTimeAccounting();
+
+    // Zone process side of TestSharedClock(), which starts it as "sanear-test SharedClockZone <arguments>".
+    int RunSharedClockZone(int argc, char* argv[]);
+}
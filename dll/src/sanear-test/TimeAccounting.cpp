@@ -0,0 +1,241 @@
+#include "pch.h"
+#include "Test.h"
+
+#include "../sanear-bench/BenchSample.h"
+
+#include "../../../src/SampleCorrection.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const uint32_t Channels = 2;
+        const size_t SampleFrames = 1024;
+        const size_t SamplesPerFormat = 3000;
+        const int64_t Duration = 10ll * 60 * 60 * OneSecond;
+
+        // The format alternates between these two. Timestamps come out of exact integer math below,
+        // which relies on 10^7 / lcm(44100, 48000) being 625 / 441.
+        const uint32_t Rates[] = {44100, 48000};
+        const uint64_t RateWeights[] = {160, 147}; // lcm(44100, 48000) / rate
+
+        struct SegmentRate
+        {
+            const char* name;
+            uint32_t numerator;
+            uint32_t denominator;
+        };
+
+        const SegmentRate SegmentRates[] = {
+            {"1.0",   1,    1},
+            {"1.001", 1001, 1000},
+            {"25/24", 25,   24},
+            {"0.959", 959,  1000},
+        };
+
+        struct Result
+        {
+            REFERENCE_TIME maxDivergence = 0;
+            uint32_t clockOffsets = 0; // Ones ApplyClockCorrection() would make, over 100 ticks.
+            uint32_t corrections = 0;  // Pads, crops and drops with every sample marked as a discontinuity.
+        };
+
+        // SampleCorrection time accounting as it was before the exact rational math, for comparison.
+        // Truncating llMulDiv() followed by a double rate multiply, truncated again at every format change.
+        class LegacyCorrection final
+        {
+        public:
+
+            void NewFormat(SharedWaveFormat format)
+            {
+                if (m_format)
+                {
+                    m_segmentTimeInPreviousFormats += FramesToTime(m_segmentFramesInCurrentFormat);
+                    m_segmentFramesInCurrentFormat = 0;
+                }
+
+                m_format = format;
+            }
+
+            void NewSegment(double rate)
+            {
+                m_segmentRate = rate;
+                m_segmentTimeInPreviousFormats = 0;
+                m_segmentFramesInCurrentFormat = 0;
+                m_lastFrameEnd = 0;
+                m_timeDivergence = 0;
+            }
+
+            // Same decisions as SampleCorrection::ProcessSample() for a non-realtime device, frame counts only.
+            void ProcessSample(IMediaSample*, AM_SAMPLE2_PROPERTIES& props, bool)
+            {
+                size_t frames = props.lActual / m_format->nBlockAlign;
+
+                m_lastSampleCorrected = false;
+
+                if (m_lastFrameEnd == 0 || (props.dwSampleFlags & AM_SAMPLE_TIMEDISCONTINUITY))
+                {
+                    if (props.tStop <= m_lastFrameEnd)
+                    {
+                        frames = 0;
+                        m_lastSampleCorrected = true;
+                    }
+                    else if (props.tStart < m_lastFrameEnd)
+                    {
+                        const size_t cropFrames = (size_t)TimeToFrames(m_lastFrameEnd - props.tStart);
+
+                        if (cropFrames > 0)
+                        {
+                            frames -= std::min(frames, cropFrames);
+                            props.tStart += FramesToTime(cropFrames);
+                            m_lastSampleCorrected = true;
+                        }
+                    }
+                    else if (props.tStart > m_lastFrameEnd)
+                    {
+                        const size_t padFrames = (size_t)TimeToFrames(props.tStart - m_lastFrameEnd);
+
+                        if (padFrames > 0 && FramesToTime(padFrames) < 10 * OneSecond)
+                        {
+                            frames += padFrames;
+                            props.tStart -= FramesToTime(padFrames);
+                            m_lastSampleCorrected = true;
+                        }
+                    }
+                }
+
+                if (frames == 0)
+                    return;
+
+                m_timeDivergence = props.tStart - m_lastFrameEnd;
+                m_segmentFramesInCurrentFormat += frames;
+                m_lastFrameEnd = m_segmentTimeInPreviousFormats + FramesToTime(m_segmentFramesInCurrentFormat);
+            }
+
+            REFERENCE_TIME GetTimeDivergence() const { return m_timeDivergence; }
+            bool IsLastSampleCorrected() const { return m_lastSampleCorrected; }
+
+        private:
+
+            uint64_t TimeToFrames(REFERENCE_TIME time)
+            {
+                return (uint64_t)(llMulDiv(time, m_format->nSamplesPerSec, OneSecond, 0) * m_segmentRate);
+            }
+
+            REFERENCE_TIME FramesToTime(uint64_t frames)
+            {
+                return (REFERENCE_TIME)(llMulDiv(frames, OneSecond, m_format->nSamplesPerSec, 0) / m_segmentRate);
+            }
+
+            SharedWaveFormat m_format;
+            double m_segmentRate = 1.0;
+
+            REFERENCE_TIME m_segmentTimeInPreviousFormats = 0;
+            uint64_t m_segmentFramesInCurrentFormat = 0;
+            REFERENCE_TIME m_lastFrameEnd = 0;
+            REFERENCE_TIME m_timeDivergence = 0;
+            bool m_lastSampleCorrected = false;
+        };
+
+        SharedWaveFormat MakeWaveFormat(uint32_t rate)
+        {
+            WAVEFORMATEX format = {};
+            format.wFormatTag = WAVE_FORMAT_PCM;
+            format.nChannels = Channels;
+            format.nSamplesPerSec = rate;
+            format.wBitsPerSample = 16;
+            format.nBlockAlign = Channels * 2;
+            format.nAvgBytesPerSec = format.nBlockAlign * rate;
+            return CopyWaveFormat(format);
+        }
+
+        // Feeds 10 hours of samples with exactly rounded timestamps, the way a well behaved source would.
+        // With discontinuities every sample goes through the pad/crop decisions.
+        template <typename Correction>
+        Result Simulate(const SegmentRate& segmentRate, bool discontinuities)
+        {
+            const SharedWaveFormat formats[] = {MakeWaveFormat(Rates[0]), MakeWaveFormat(Rates[1])};
+            BenchSample sample(SampleFrames * formats[0]->nBlockAlign);
+
+            Correction correction;
+            correction.NewSegment((double)segmentRate.numerator / segmentRate.denominator);
+
+            Result result;
+            REFERENCE_TIME clockCorrection = 0;
+
+            // Frames so far in each format, the exact stream time is
+            // 625 * denominator * (160 * frames44100 + 147 * frames48000) / (441 * numerator) ticks.
+            uint64_t frames[2] = {};
+            const int64_t divisor = 441ll * segmentRate.numerator;
+
+            auto getTime = [&]
+            {
+                const int64_t weighted = (int64_t)(RateWeights[0] * frames[0] + RateWeights[1] * frames[1]);
+                return (625ll * segmentRate.denominator * weighted + divisor / 2) / divisor;
+            };
+
+            for (size_t n = 0; getTime() < Duration; n++)
+            {
+                const size_t format = (n / SamplesPerFormat) % 2;
+
+                if (n % SamplesPerFormat == 0)
+                    correction.NewFormat(formats[format]);
+
+                AM_SAMPLE2_PROPERTIES props = sample.GetProperties();
+                props.dwSampleFlags = AM_SAMPLE_TIMEVALID | AM_SAMPLE_STOPVALID;
+                props.tStart = getTime();
+                frames[format] += SampleFrames;
+                props.tStop = getTime();
+
+                if (discontinuities)
+                    props.dwSampleFlags |= AM_SAMPLE_TIMEDISCONTINUITY;
+
+                correction.ProcessSample(&sample, props, false);
+
+                const REFERENCE_TIME divergence = correction.GetTimeDivergence();
+                result.maxDivergence = std::max(result.maxDivergence, std::abs(divergence));
+
+                // What ApplyClockCorrection() does with it.
+                if (std::abs(divergence - clockCorrection) > 100)
+                {
+                    clockCorrection = divergence;
+                    result.clockOffsets++;
+                }
+
+                if (correction.IsLastSampleCorrected())
+                    result.corrections++;
+            }
+
+            return result;
+        }
+
+        // Divergence and clock offsets come from a plain run, corrections from a run with discontinuities.
+        template <typename Correction>
+        Result Measure(const SegmentRate& segmentRate)
+        {
+            Result result = Simulate<Correction>(segmentRate, false);
+            result.corrections = Simulate<Correction>(segmentRate, true).corrections;
+            return result;
+        }
+    }
+
+    bool TestTimeAccounting()
+    {
+        bool passed = true;
+
+        for (const auto& segmentRate : SegmentRates)
+        {
+            const Result before = Measure<LegacyCorrection>(segmentRate);
+            const Result after = Measure<SampleCorrection>(segmentRate);
+
+            printf("  rate %s, before: %d ticks max divergence, %u pad/crop, %u clock offsets; "
+                   "after: %d ticks, %u pad/crop, %u clock offsets\n", segmentRate.name,
+                   (int)before.maxDivergence, before.corrections, before.clockOffsets,
+                   (int)after.maxDivergence, after.corrections, after.clockOffsets);
+
+            passed = after.maxDivergence <= 1 && after.corrections == 0 && after.clockOffsets == 0 && passed;
+        }
+
+        return passed;
+    }
+}
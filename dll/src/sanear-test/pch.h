@@ -0,0 +1,6 @@
+#pragma once
+
+#include "../../../src/pch.h"
+
+#include <cstdio>
+#include <vector>
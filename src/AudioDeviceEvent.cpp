@@ -1,454 +1,510 @@
-#include "pch.h"
-#include "AudioDeviceEvent.h"
-
-namespace SaneAudioRenderer
-{
-    namespace
-    {
-        WinapiFunc<decltype(AvSetMmThreadCharacteristicsW)>
-        AvSetMmThreadCharacteristicsFunction(L"avrt.dll", "AvSetMmThreadCharacteristicsW");
-
-        WinapiFunc<decltype(AvRevertMmThreadCharacteristics)>
-        AvRevertMmThreadCharacteristicsFunction(L"avrt.dll", "AvRevertMmThreadCharacteristics");
-    }
-
-    AudioDeviceEvent::AudioDeviceEvent(std::shared_ptr<AudioDeviceBackend> backend)
-    {
-        DebugOut(ClassName(this), "create");
-
-        assert(backend);
-        assert(backend->eventMode);
-        m_backend = backend;
-
-        if (static_cast<HANDLE>(m_wake) == NULL ||
-            static_cast<HANDLE>(m_observeInactivityWake) == NULL)
-        {
-            throw E_OUTOFMEMORY;
-        }
-
-        ThrowIfFailed(backend->audioClient->SetEventHandle(m_wake));
-
-        m_thread = std::thread(std::bind(&AudioDeviceEvent::EventFeed, this));
-    }
-
-    AudioDeviceEvent::~AudioDeviceEvent()
-    {
-        DebugOut(ClassName(this), "destroy");
-
-        m_exit = true;
-        m_wake.Set();
-
-        if (m_thread.joinable())
-            m_thread.join();
-
-        assert(CheckLastInstances());
-        m_backend = nullptr;
-    }
-
-    void AudioDeviceEvent::Push(DspChunk& chunk, CAMEvent* pFilledEvent)
-    {
-        assert(!m_endOfStream);
-
-        if (m_error)
-            throw E_FAIL;
-
-        PushChunkToBuffer(chunk);
-
-        if (pFilledEvent && !chunk.IsEmpty())
-            pFilledEvent->Set();
-    }
-
-    REFERENCE_TIME AudioDeviceEvent::Finish(CAMEvent* pFilledEvent)
-    {
-        if (m_error)
-            throw E_FAIL;
-
-        if (!m_endOfStream)
-        {
-            DebugOut(ClassName(this), "finish");
-            m_endOfStream = true;
-            m_endOfStreamPos = GetEnd();
-        }
-
-        if (pFilledEvent)
-            pFilledEvent->Set();
-
-        return m_endOfStreamPos - GetPosition();
-    }
-
-    int64_t AudioDeviceEvent::GetPosition()
-    {
-        CAutoLock renewLock(&m_renewMutex);
-
-        if (m_awaitingRenew)
-            return m_renewPosition;
-
-        UINT64 deviceClockFrequency, deviceClockPosition;
-        ThrowIfFailed(m_backend->audioClock->GetFrequency(&deviceClockFrequency));
-        ThrowIfFailed(m_backend->audioClock->GetPosition(&deviceClockPosition, nullptr));
-
-        return m_renewPosition + llMulDiv(deviceClockPosition, OneSecond, deviceClockFrequency, 0);
-    }
-
-    int64_t AudioDeviceEvent::GetEnd()
-    {
-        return FramesToTimeLong(m_receivedFrames, GetRate());
-    }
-
-    int64_t AudioDeviceEvent::GetSilence()
-    {
-        return FramesToTimeLong(m_silenceFrames, GetRate());
-    }
-
-    void AudioDeviceEvent::Start()
-    {
-        bool delegateStart = false;
-
-        {
-            CAutoLock threadLock(&m_threadMutex);
-
-            m_observeInactivity = false;
-
-            if (m_sentFrames == 0)
-            {
-                m_queuedStart = true;
-                delegateStart = true;
-            }
-        }
-
-        if (delegateStart)
-        {
-            DebugOut(ClassName(this), "queue start");
-            m_wake.Set();
-        }
-        else
-        {
-            DebugOut(ClassName(this), "start");
-            m_backend->audioClient->Start();
-        }
-    }
-
-    void AudioDeviceEvent::Stop()
-    {
-        DebugOut(ClassName(this), "stop");
-
-        {
-            CAutoLock threadLock(&m_threadMutex);
-
-            m_queuedStart = false;
-
-            CAutoLock renewLock(&m_renewMutex);
-
-            if (m_awaitingRenew)
-                return;
-
-            m_backend->audioClient->Stop();
-
-            if (m_backend->exclusive && !m_backend->bitstream)
-            {
-                m_observeInactivity = true;
-                m_activityPointCounter = GetPerformanceCounter();
-                m_observeInactivityWake.Set();
-            }
-        }
-    }
-
-    void AudioDeviceEvent::Reset()
-    {
-        DebugOut(ClassName(this), "reset");
-
-        {
-            CAutoLock threadLock(&m_threadMutex);
-
-            CAutoLock renewLock(&m_renewMutex);
-
-            if (!m_awaitingRenew)
-                m_backend->audioClient->Reset();
-
-            m_renewPosition = 0;
-            m_renewSilenceFrames = 0;
-
-            m_endOfStream = false;
-            m_endOfStreamPos = 0;
-
-            m_receivedFrames = 0;
-            m_sentFrames = 0;
-            m_silenceFrames = 0;
-
-            {
-                CAutoLock bufferLock(&m_bufferMutex);
-                m_bufferFrames = 0;
-                m_buffer.clear();
-            }
-
-            if (m_observeInactivity)
-                m_activityPointCounter = GetPerformanceCounter();
-        }
-    }
-
-    bool AudioDeviceEvent::RenewInactive(const RenewBackendFunction& renewBackend, int64_t& position)
-    {
-        CAutoLock threadLock(&m_threadMutex);
-
-        m_observeInactivity = false;
-
-        if (m_error)
-            return false;
-
-        CAutoLock renewLock(&m_renewMutex);
-
-        if (m_awaitingRenew)
-        {
-            DebugOut(ClassName(this), "renew");
-
-            if (!renewBackend(m_backend))
-                return false;
-
-            ThrowIfFailed(m_backend->audioClient->SetEventHandle(m_wake));
-            m_awaitingRenew = false;
-
-            if (m_renewSilenceFrames > 0)
-            {
-                DebugOut(ClassName(this), m_renewSilenceFrames, "frames of silence before renew");
-
-                DspChunk chunk = DspChunk(m_backend->dspFormat, m_backend->waveFormat->nChannels,
-                                          m_renewSilenceFrames, m_backend->waveFormat->nSamplesPerSec);
-
-                ZeroMemory(chunk.GetData(), chunk.GetSize());
-
-                {
-                    CAutoLock bufferLock(&m_bufferMutex);
-                    m_buffer.emplace_front(std::move(chunk));
-                    m_bufferFrames += m_renewSilenceFrames;
-                }
-
-                m_renewPosition -= FramesToTime(m_renewSilenceFrames, GetRate());
-            }
-
-            position = m_renewPosition;
-        }
-
-        return true;
-    }
-
-    void AudioDeviceEvent::EventFeed()
-    {
-        HANDLE taskHandle = NULL;
-        if (AvSetMmThreadCharacteristicsFunction && AvRevertMmThreadCharacteristicsFunction)
-        {
-            DWORD taskIndex = 0;
-            taskHandle = AvSetMmThreadCharacteristicsFunction(L"Pro Audio", &taskIndex);
-            assert(taskHandle != NULL);
-        }
-
-        if (taskHandle == NULL)
-            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
-
-        for (DWORD waitTime = INFINITE;;)
-        {
-            HRESULT waitResult = WaitForAny(waitTime, m_wake, m_observeInactivityWake);
-
-            if (m_exit || m_error)
-                break;
-
-            switch (waitResult)
-            {
-                case WAIT_OBJECT_0:
-                {
-                    CAutoLock threadLock(&m_threadMutex);
-
-                    assert(m_sentFrames > 0 || m_queuedStart);
-
-                    try
-                    {
-                        PushBufferToDevice();
-
-                        if (m_queuedStart)
-                        {
-                            DebugOut(ClassName(this), "start");
-                            m_backend->audioClient->Start();
-                            m_queuedStart = false;
-                        }
-                    }
-                    catch (HRESULT)
-                    {
-                        m_error = true;
-                    }
-
-                    break;
-                }
-
-                case WAIT_OBJECT_0 + 1:
-                case WAIT_TIMEOUT:
-                {
-                    CAutoLock threadLock(&m_threadMutex);
-
-                    waitTime = INFINITE;
-
-                    if (m_observeInactivity)
-                    {
-                        int64_t delay = GetPerformanceFrequency() / 5; // 200ms
-                        int64_t remaining = m_activityPointCounter + delay - GetPerformanceCounter();
-
-                        if (remaining > 0)
-                        {
-                            waitTime = (DWORD)llMulDiv(remaining, 1000, GetPerformanceFrequency(), 0) + 1;
-                        }
-                        else
-                        {
-                            CAutoLock renewLock(&m_renewMutex);
-
-                            DebugOut(ClassName(this), "awaiting renew");
-
-                            int64_t currentPosition = GetPosition();
-                            m_renewPosition = FramesToTimeLong(m_receivedFrames - m_bufferFrames, GetRate());
-
-                            try
-                            {
-                                int64_t renewSilence = m_renewPosition - currentPosition;
-                                if (renewSilence > 0)
-                                    m_renewSilenceFrames = TimeToFrames(renewSilence, GetRate());
-                            }
-                            catch (HRESULT)
-                            {
-                                m_renewSilenceFrames = 0;
-                            }
-
-                            assert(CheckLastInstances());
-                            m_backend->audioClock = nullptr;
-                            m_backend->audioRenderClient = nullptr;
-                            m_backend->audioClient = nullptr;
-
-                            m_sentFrames = 0;
-
-                            m_awaitingRenew = true;
-                            m_observeInactivity = false;
-                        }
-                    }
-
-                    break;
-                }
-
-                default:
-                {
-                    DebugOut(ClassName(this), "wait error");
-                    m_error = true;
-                }
-            }
-        }
-
-        if (taskHandle != NULL)
-            AvRevertMmThreadCharacteristicsFunction(taskHandle);
-    }
-
-    void AudioDeviceEvent::PushBufferToDevice()
-    {
-        UINT32 deviceFrames = m_backend->deviceBufferSize;
-
-        if (!m_backend->exclusive)
-        {
-            UINT32 bufferPadding;
-            ThrowIfFailed(m_backend->audioClient->GetCurrentPadding(&bufferPadding));
-            deviceFrames -= bufferPadding;
-        }
-
-        if (deviceFrames == 0)
-            return;
-
-        CAutoLock bufferLock(&m_bufferMutex);
-
-        if (deviceFrames > m_bufferFrames && !m_endOfStream && !m_backend->realtime)
-        {
-            DebugOut(ClassName(this), "buffer underrun");
-            return;
-        }
-
-        BYTE* deviceBuffer;
-        ThrowIfFailed(m_backend->audioRenderClient->GetBuffer(deviceFrames, &deviceBuffer));
-
-        const size_t frameSize = m_backend->waveFormat->wBitsPerSample / 8 * m_backend->waveFormat->nChannels;
-
-        for (UINT32 doneFrames = 0;;)
-        {
-            if (m_buffer.empty())
-            {
-                assert(m_endOfStream || m_backend->realtime);
-                UINT32 doFrames = deviceFrames - doneFrames;
-
-                if (doneFrames == 0)
-                {
-                    ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, AUDCLNT_BUFFERFLAGS_SILENT));
-                }
-                else
-                {
-                    ZeroMemory(deviceBuffer + doneFrames * frameSize, doFrames * frameSize);
-                    ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, 0));
-                }
-
-                DebugOut(ClassName(this), "silence", doFrames * 1000. / m_backend->waveFormat->nSamplesPerSec, "ms");
-
-                m_silenceFrames += doFrames;
-
-                break;
-            }
-            else
-            {
-                DspChunk& chunk = m_buffer.front();
-                UINT32 doFrames = std::min(deviceFrames - doneFrames, (UINT32)chunk.GetFrameCount());
-                assert(chunk.GetFrameSize() == frameSize);
-                memcpy(deviceBuffer + doneFrames * frameSize, chunk.GetData(), doFrames * frameSize);
-
-                doneFrames += doFrames;
-                m_bufferFrames -= doFrames;
-
-                if (deviceFrames == doneFrames)
-                {
-                    ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, 0));
-
-                    chunk.ShrinkHead(chunk.GetFrameCount() - doFrames);
-                    if (chunk.IsEmpty())
-                        m_buffer.pop_front();
-
-                    break;
-                }
-
-                m_buffer.pop_front();
-            }
-        }
-
-        m_sentFrames += deviceFrames;
-    }
-
-    void AudioDeviceEvent::PushChunkToBuffer(DspChunk& chunk)
-    {
-        if (chunk.IsEmpty())
-            return;
-
-        try
-        {
-            // Don't deny the allocator its right to reuse
-            // IMediaSample while the chunk is hanging in the buffer.
-            chunk.FreeMediaSample();
-
-            size_t targetFrames = (size_t)llMulDiv(m_backend->bufferDuration,
-                                                   m_backend->waveFormat->nSamplesPerSec, 1000, 0);
-
-            CAutoLock bufferLock(&m_bufferMutex);
-
-            if (m_bufferFrames > targetFrames)
-                return;
-
-            size_t chunkFrames = chunk.GetFrameCount();
-
-            m_bufferFrames += chunkFrames;
-            m_buffer.emplace_back(std::move(chunk));
-
-            m_receivedFrames += chunkFrames;
-        }
-        catch (std::bad_alloc&)
-        {
-            m_error = true;
-            throw E_OUTOFMEMORY;
-        }
-    }
-}
+#include "pch.h"
+#include "AudioDeviceEvent.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        WinapiFunc<decltype(AvSetMmThreadCharacteristicsW)>
+        AvSetMmThreadCharacteristicsFunction(L"avrt.dll", "AvSetMmThreadCharacteristicsW");
+
+        WinapiFunc<decltype(AvRevertMmThreadCharacteristics)>
+        AvRevertMmThreadCharacteristicsFunction(L"avrt.dll", "AvRevertMmThreadCharacteristics");
+    }
+
+    AudioDeviceEvent::AudioDeviceEvent(std::shared_ptr<AudioDeviceBackend> backend)
+    {
+        DebugOut(ClassName(this), "create");
+
+        assert(backend);
+        assert(backend->eventMode);
+        m_backend = backend;
+
+        if (static_cast<HANDLE>(m_wake) == NULL ||
+            static_cast<HANDLE>(m_observeInactivityWake) == NULL)
+        {
+            throw E_OUTOFMEMORY;
+        }
+
+        ThrowIfFailed(backend->audioClient->SetEventHandle(m_wake));
+
+        {
+            // Leave enough room above the target for one device period worth of overshoot.
+            // Exclusive mode wakes always take exactly one period, so with the capacity rounded up
+            // to whole periods every read there is a single contiguous copy out of the ring.
+            // Shared mode wakes take whatever the engine has room for and can still wrap.
+            const size_t frameSize = backend->waveFormat->wBitsPerSample / 8 * backend->waveFormat->nChannels;
+            const size_t period = backend->deviceBufferSize;
+            m_buffer.Allocate((GetTargetFrames() + period + period - 1) / period * period, (uint32_t)frameSize);
+
+            DebugOut(ClassName(this), "ring buffer", m_buffer.GetCapacity(), "frames",
+                     m_buffer.GetCapacity() * frameSize / 1024, "KiB");
+
+            m_refilling = (backend->deepBufferDuration > 0);
+        }
+
+        m_thread = std::thread(std::bind(&AudioDeviceEvent::EventFeed, this));
+    }
+
+    AudioDeviceEvent::~AudioDeviceEvent()
+    {
+        DebugOut(ClassName(this), "destroy");
+
+        m_exit = true;
+        m_wake.Set();
+
+        if (m_thread.joinable())
+            m_thread.join();
+
+        if (m_wakeCount > 0)
+        {
+            DebugOut(ClassName(this), "feed thread spent", GetAverageWakeMicroseconds(), "us per wake on average,",
+                     m_maxWakeTime * 1000000. / GetPerformanceFrequency(), "us max, over", m_wakeCount, "wakes");
+        }
+
+        assert(CheckLastInstances());
+        m_backend = nullptr;
+    }
+
+    void AudioDeviceEvent::Push(DspChunk& chunk, CAMEvent* pFilledEvent)
+    {
+        assert(!m_endOfStream);
+
+        if (m_error)
+            throw E_FAIL;
+
+        PushChunkToBuffer(chunk);
+
+        if (pFilledEvent && !chunk.IsEmpty())
+            pFilledEvent->Set();
+    }
+
+    size_t AudioDeviceEvent::PushSilence(size_t frames)
+    {
+        assert(!m_endOfStream);
+
+        if (m_error)
+            throw E_FAIL;
+
+        ProfiledLock(bufferLock, &m_bufferMutex);
+
+        const size_t doFrames = m_buffer.WriteSilence(frames);
+        m_receivedFrames += doFrames;
+
+        return doFrames;
+    }
+
+    REFERENCE_TIME AudioDeviceEvent::Finish(CAMEvent* pFilledEvent, CAMEvent* pEndOfStreamEvent)
+    {
+        if (m_error)
+            throw E_FAIL;
+
+        if (!m_endOfStream)
+        {
+            DebugOut(ClassName(this), "finish");
+
+            ProfiledLock(threadLock, &m_threadMutex);
+            // Position runs through the silence played on underruns and refills too, received frames don't.
+            m_endOfStreamPos = GetEnd() + GetSilence();
+            m_pEndOfStreamEvent = pEndOfStreamEvent;
+            m_endOfStreamSignaled = false;
+            m_endOfStream = true;
+        }
+
+        if (pFilledEvent)
+            pFilledEvent->Set();
+
+        return m_endOfStreamPos - GetPosition();
+    }
+
+    int64_t AudioDeviceEvent::GetPosition()
+    {
+        ProfiledLock(renewLock, &m_renewMutex);
+
+        if (m_awaitingRenew)
+            return m_renewPosition;
+
+        UINT64 deviceClockFrequency, deviceClockPosition;
+        ThrowIfFailed(m_backend->audioClock->GetFrequency(&deviceClockFrequency));
+        ThrowIfFailed(m_backend->audioClock->GetPosition(&deviceClockPosition, nullptr));
+
+        return m_renewPosition + llMulDiv(deviceClockPosition, OneSecond, deviceClockFrequency, 0);
+    }
+
+    int64_t AudioDeviceEvent::GetEnd()
+    {
+        return FramesToTimeLong(m_receivedFrames, GetRate());
+    }
+
+    int64_t AudioDeviceEvent::GetSilence()
+    {
+        return FramesToTimeLong(m_silenceFrames, GetRate());
+    }
+
+    void AudioDeviceEvent::Start()
+    {
+        bool delegateStart = false;
+
+        {
+            ProfiledLock(threadLock, &m_threadMutex);
+
+            m_observeInactivity = false;
+
+            if (m_sentFrames == 0)
+            {
+                m_queuedStart = true;
+                delegateStart = true;
+            }
+        }
+
+        if (delegateStart)
+        {
+            DebugOut(ClassName(this), "queue start");
+            m_wake.Set();
+        }
+        else
+        {
+            DebugOut(ClassName(this), "start");
+            m_backend->audioClient->Start();
+        }
+    }
+
+    void AudioDeviceEvent::Stop()
+    {
+        DebugOut(ClassName(this), "stop");
+
+        {
+            ProfiledLock(threadLock, &m_threadMutex);
+
+            m_queuedStart = false;
+
+            ProfiledLock(renewLock, &m_renewMutex);
+
+            if (m_awaitingRenew)
+                return;
+
+            m_backend->audioClient->Stop();
+
+            if (m_backend->exclusive && !m_backend->bitstream)
+            {
+                m_observeInactivity = true;
+                m_activityPointCounter = GetPerformanceCounter();
+                m_observeInactivityWake.Set();
+            }
+        }
+    }
+
+    void AudioDeviceEvent::Reset()
+    {
+        DebugOut(ClassName(this), "reset");
+
+        {
+            ProfiledLock(threadLock, &m_threadMutex);
+
+            ProfiledLock(renewLock, &m_renewMutex);
+
+            if (!m_awaitingRenew)
+                m_backend->audioClient->Reset();
+
+            m_renewPosition = 0;
+            m_renewSilenceFrames = 0;
+
+            m_endOfStream = false;
+            m_endOfStreamPos = 0;
+            m_pEndOfStreamEvent = nullptr;
+            m_endOfStreamSignaled = false;
+
+            m_receivedFrames = 0;
+            m_sentFrames = 0;
+            m_silenceFrames = 0;
+
+            {
+                ProfiledLock(bufferLock, &m_bufferMutex);
+                m_buffer.Clear();
+                m_refilling = (m_backend->deepBufferDuration > 0);
+            }
+
+            if (m_observeInactivity)
+                m_activityPointCounter = GetPerformanceCounter();
+        }
+    }
+
+    bool AudioDeviceEvent::RenewInactive(const RenewBackendFunction& renewBackend, int64_t& position)
+    {
+        ProfiledLock(threadLock, &m_threadMutex);
+
+        m_observeInactivity = false;
+
+        if (m_error)
+            return false;
+
+        ProfiledLock(renewLock, &m_renewMutex);
+
+        if (m_awaitingRenew)
+        {
+            DebugOut(ClassName(this), "renew");
+
+            if (!renewBackend(m_backend))
+                return false;
+
+            ThrowIfFailed(m_backend->audioClient->SetEventHandle(m_wake));
+            m_awaitingRenew = false;
+
+            if (m_renewSilenceFrames > 0)
+            {
+                DebugOut(ClassName(this), m_renewSilenceFrames, "frames of silence before renew");
+
+                {
+                    ProfiledLock(bufferLock, &m_bufferMutex);
+
+                    size_t silenceFrames = m_renewSilenceFrames;
+
+                    // Whole periods keep the read head on a period boundary for exclusive mode wakes,
+                    // the nearest one keeps the position jump within half a period.
+                    if (m_backend->exclusive)
+                    {
+                        const size_t period = m_backend->deviceBufferSize;
+                        silenceFrames = std::min((silenceFrames + period / 2) / period * period,
+                                                 m_buffer.GetFreeCount() / period * period);
+                    }
+
+                    m_renewSilenceFrames = m_buffer.PrependSilence(silenceFrames);
+                }
+
+                m_renewPosition -= FramesToTime(m_renewSilenceFrames, GetRate());
+            }
+
+            position = m_renewPosition;
+        }
+
+        return true;
+    }
+
+    void AudioDeviceEvent::EventFeed()
+    {
+        HANDLE taskHandle = NULL;
+        if (AvSetMmThreadCharacteristicsFunction && AvRevertMmThreadCharacteristicsFunction)
+        {
+            DWORD taskIndex = 0;
+            taskHandle = AvSetMmThreadCharacteristicsFunction(L"Pro Audio", &taskIndex);
+            assert(taskHandle != NULL);
+        }
+
+        if (taskHandle == NULL)
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+        for (DWORD waitTime = INFINITE;;)
+        {
+            HRESULT waitResult = WaitForAny(waitTime, m_wake, m_observeInactivityWake);
+
+            if (m_exit || m_error)
+                break;
+
+            switch (waitResult)
+            {
+                case WAIT_OBJECT_0:
+                {
+                    ProfiledLock(threadLock, &m_threadMutex);
+
+                    assert(m_sentFrames > 0 || m_queuedStart);
+
+                    const int64_t wakeStart = GetPerformanceCounter();
+
+                    try
+                    {
+                        PushBufferToDevice();
+
+                        if (m_queuedStart)
+                        {
+                            DebugOut(ClassName(this), "start");
+                            m_backend->audioClient->Start();
+                            m_queuedStart = false;
+                        }
+
+                        CheckEndOfStream();
+                    }
+                    catch (HRESULT)
+                    {
+                        m_error = true;
+                    }
+
+                    const int64_t wakeTime = GetPerformanceCounter() - wakeStart;
+                    m_totalWakeTime += wakeTime;
+                    m_maxWakeTime = std::max(m_maxWakeTime, wakeTime);
+                    m_wakeCount++;
+
+                    break;
+                }
+
+                case WAIT_OBJECT_0 + 1:
+                case WAIT_TIMEOUT:
+                {
+                    ProfiledLock(threadLock, &m_threadMutex);
+
+                    waitTime = INFINITE;
+
+                    if (m_observeInactivity)
+                    {
+                        int64_t delay = GetPerformanceFrequency() / 5; // 200ms
+                        int64_t remaining = m_activityPointCounter + delay - GetPerformanceCounter();
+
+                        if (remaining > 0)
+                        {
+                            waitTime = (DWORD)llMulDiv(remaining, 1000, GetPerformanceFrequency(), 0) + 1;
+                        }
+                        else
+                        {
+                            ProfiledLock(renewLock, &m_renewMutex);
+
+                            DebugOut(ClassName(this), "awaiting renew");
+
+                            int64_t currentPosition = GetPosition();
+                            m_renewPosition = FramesToTimeLong(m_receivedFrames - m_buffer.GetFrameCount(), GetRate());
+
+                            try
+                            {
+                                int64_t renewSilence = m_renewPosition - currentPosition;
+                                if (renewSilence > 0)
+                                    m_renewSilenceFrames = TimeToFrames(renewSilence, GetRate());
+                            }
+                            catch (HRESULT)
+                            {
+                                m_renewSilenceFrames = 0;
+                            }
+
+                            assert(CheckLastInstances());
+                            m_backend->audioClock = nullptr;
+                            m_backend->audioRenderClient = nullptr;
+                            m_backend->audioClient = nullptr;
+
+                            m_sentFrames = 0;
+
+                            m_awaitingRenew = true;
+                            m_observeInactivity = false;
+                        }
+                    }
+
+                    break;
+                }
+
+                default:
+                {
+                    DebugOut(ClassName(this), "wait error");
+                    m_error = true;
+                }
+            }
+        }
+
+        if (taskHandle != NULL)
+            AvRevertMmThreadCharacteristicsFunction(taskHandle);
+    }
+
+    void AudioDeviceEvent::PushBufferToDevice()
+    {
+        UINT32 deviceFrames = m_backend->deviceBufferSize;
+
+        if (!m_backend->exclusive)
+        {
+            UINT32 bufferPadding;
+            ThrowIfFailed(m_backend->audioClient->GetCurrentPadding(&bufferPadding));
+            deviceFrames -= bufferPadding;
+        }
+
+        if (deviceFrames == 0)
+            return;
+
+        ProfiledLock(bufferLock, &m_bufferMutex);
+
+        const size_t bufferFrames = m_buffer.GetFrameCount();
+
+        if (m_backend->deepBufferDuration > 0)
+        {
+            // Hysteresis: after running dry, hold the output until half of the deep buffer is filled again.
+            if (m_refilling && (bufferFrames >= GetTargetFrames() / 2 || m_endOfStream))
+            {
+                DebugOut(ClassName(this), "refilled with", bufferFrames * 1000. / GetRate(), "ms");
+                m_refilling = false;
+            }
+            else if (!m_refilling && bufferFrames < deviceFrames && !m_endOfStream)
+            {
+                DebugOut(ClassName(this), "buffer underrun, refilling");
+                m_refilling = true;
+            }
+        }
+        else if (deviceFrames > bufferFrames && !m_endOfStream && !m_backend->realtime)
+        {
+            DebugOut(ClassName(this), "buffer underrun");
+            return;
+        }
+
+        BYTE* deviceBuffer;
+        ThrowIfFailed(m_backend->audioRenderClient->GetBuffer(deviceFrames, &deviceBuffer));
+
+        const UINT32 doneFrames = m_refilling ? 0 : (UINT32)m_buffer.Read((char*)deviceBuffer, deviceFrames);
+
+        if (doneFrames < deviceFrames)
+        {
+            assert(m_endOfStream || m_backend->realtime || m_refilling);
+            UINT32 doFrames = deviceFrames - doneFrames;
+
+            if (doneFrames == 0)
+            {
+                ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, AUDCLNT_BUFFERFLAGS_SILENT));
+            }
+            else
+            {
+                const size_t frameSize = m_buffer.GetFrameSize();
+                ZeroMemory(deviceBuffer + doneFrames * frameSize, doFrames * frameSize);
+                ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, 0));
+            }
+
+            DebugOut(ClassName(this), "silence", doFrames * 1000. / m_backend->waveFormat->nSamplesPerSec, "ms");
+
+            m_silenceFrames += doFrames;
+        }
+        else
+        {
+            ThrowIfFailed(m_backend->audioRenderClient->ReleaseBuffer(deviceFrames, 0));
+        }
+
+        m_sentFrames += deviceFrames;
+    }
+
+    void AudioDeviceEvent::PushChunkToBuffer(DspChunk& chunk)
+    {
+        if (chunk.IsEmpty())
+            return;
+
+        assert(chunk.GetChannelCount() == m_backend->waveFormat->nChannels);
+
+        ProfiledLock(bufferLock, &m_bufferMutex);
+
+        if (m_buffer.GetFrameCount() > GetTargetFrames())
+            return;
+
+        m_receivedFrames += m_buffer.Write(chunk, m_backend->dspFormat);
+    }
+
+    void AudioDeviceEvent::CheckEndOfStream()
+    {
+        // Device period wakes are the finest clock we have without raising the system timer resolution.
+        if (m_endOfStream && !m_endOfStreamSignaled && m_pEndOfStreamEvent &&
+            GetPosition() >= m_endOfStreamPos)
+        {
+            m_pEndOfStreamEvent->Set();
+            m_endOfStreamSignaled = true;
+        }
+    }
+
+    double AudioDeviceEvent::GetAverageWakeMicroseconds() const
+    {
+        return m_totalWakeTime * 1000000. / GetPerformanceFrequency() / m_wakeCount;
+    }
+
+    size_t AudioDeviceEvent::GetTargetFrames() const
+    {
+        uint32_t duration = std::max(m_backend->bufferDuration, m_backend->deepBufferDuration);
+
+        return (size_t)llMulDiv(duration, m_backend->waveFormat->nSamplesPerSec, 1000, 0);
+    }
+}
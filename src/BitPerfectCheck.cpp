@@ -0,0 +1,202 @@
+#include "pch.h"
+#include "BitPerfectCheck.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        bool HasSse42()
+        {
+            static const bool sse42 = []
+            {
+                int info[4];
+                __cpuid(info, 1);
+                return (info[2] & (1 << 20)) != 0;
+            }();
+
+            return sse42;
+        }
+
+        const std::array<uint32_t, 256>& GetCrc32cTable()
+        {
+            static const std::array<uint32_t, 256> table = []
+            {
+                std::array<uint32_t, 256> t;
+
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    uint32_t c = i;
+
+                    for (int bit = 0; bit < 8; bit++)
+                        c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : (c >> 1);
+
+                    t[i] = c;
+                }
+
+                return t;
+            }();
+
+            return table;
+        }
+
+        uint32_t Crc32cHardware(uint32_t crc, const char* data, size_t size)
+        {
+            const char* end = data + size;
+
+        #ifdef _M_X64
+            uint64_t crc64 = crc;
+
+            for (; end - data >= 8; data += 8)
+                crc64 = _mm_crc32_u64(crc64, *reinterpret_cast<const uint64_t*>(data));
+
+            crc = (uint32_t)crc64;
+        #else
+            for (; end - data >= 4; data += 4)
+                crc = _mm_crc32_u32(crc, *reinterpret_cast<const uint32_t*>(data));
+        #endif
+
+            for (; data < end; data++)
+                crc = _mm_crc32_u8(crc, (uint8_t)*data);
+
+            return crc;
+        }
+
+        uint32_t Crc32cSoftware(uint32_t crc, const char* data, size_t size)
+        {
+            const auto& table = GetCrc32cTable();
+
+            for (size_t i = 0; i < size; i++)
+                crc = table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+
+            return crc;
+        }
+    }
+
+    void BitPerfectCheck::Initialize(bool enable)
+    {
+        m_status = {};
+        m_status.enabled = enable;
+
+        Reset();
+        m_outputBase = 0;
+    }
+
+    void BitPerfectCheck::Reset()
+    {
+        m_outputBase += m_output.frames;
+        m_input = {};
+        m_output = {};
+    }
+
+    void BitPerfectCheck::Input(DspChunk& chunk)
+    {
+        if (!m_status.enabled || chunk.IsEmpty())
+            return;
+
+        Hash(m_input, chunk);
+    }
+
+    void BitPerfectCheck::Output(DspChunk& chunk, DspFormat deviceFormat, bool exclusive)
+    {
+        if (!m_status.enabled || chunk.IsEmpty())
+            return;
+
+        // Matching bytes prove nothing when the system mixer still resamples, mixes and applies volume after us.
+        if (!exclusive)
+        {
+            if (!m_status.shared)
+                DebugOut(ClassName(this), "shared mode output, can't be bit-perfect");
+
+            m_status.shared = true;
+            return;
+        }
+
+        // The device converts the chunk while copying it into its buffer, the bytes can't match.
+        if (chunk.GetFormat() != deviceFormat ||
+            chunk.GetFormat() != m_input.format ||
+            chunk.GetChannelCount() != m_input.channels ||
+            chunk.GetRate() != m_input.rate)
+        {
+            if (!m_status.converted)
+                DebugOut(ClassName(this), "output is converted, can't be bit-perfect");
+
+            m_status.converted = true;
+            return;
+        }
+
+        Hash(m_output, chunk);
+        Compare();
+    }
+
+    uint32_t BitPerfectCheck::Crc32c(uint32_t crc, const char* data, size_t size)
+    {
+        return HasSse42() ? Crc32cHardware(crc, data, size) : Crc32cSoftware(crc, data, size);
+    }
+
+    void BitPerfectCheck::Hash(Side& side, DspChunk& chunk)
+    {
+        if (side.format != chunk.GetFormat() ||
+            side.channels != chunk.GetChannelCount() ||
+            side.rate != chunk.GetRate())
+        {
+            side = {};
+            side.format = chunk.GetFormat();
+            side.channels = chunk.GetChannelCount();
+            side.rate = chunk.GetRate();
+        }
+
+        const size_t frameSize = chunk.GetFrameSize();
+        const char* data = chunk.GetData();
+        size_t frames = chunk.GetFrameCount();
+
+        while (frames > 0)
+        {
+            const size_t doFrames = std::min<size_t>(frames, BlockFrames - side.frames % BlockFrames);
+
+            side.crc = Crc32c(side.crc, data, doFrames * frameSize);
+            side.frames += doFrames;
+
+            data += doFrames * frameSize;
+            frames -= doFrames;
+
+            if (side.frames % BlockFrames == 0)
+            {
+                side.blocks.push_back(~side.crc);
+                side.crc = 0xFFFFFFFF;
+
+                // Nothing is coming out the other side, there is no point in holding on to these.
+                if (side.blocks.size() > MaxPendingBlocks)
+                    side.blocks.pop_front();
+            }
+        }
+    }
+
+    void BitPerfectCheck::Compare()
+    {
+        m_status.rate = m_output.rate;
+
+        while (!m_input.blocks.empty() && !m_output.blocks.empty())
+        {
+            if (m_input.blocks.front() == m_output.blocks.front())
+            {
+                m_status.verifiedFrames += BlockFrames;
+            }
+            else
+            {
+                const uint64_t blockFrame = m_outputBase + m_output.frames - m_output.frames % BlockFrames -
+                                            m_output.blocks.size() * BlockFrames;
+
+                if (m_status.firstMismatchFrame < 0)
+                {
+                    m_status.firstMismatchFrame = blockFrame;
+                    DebugOut(ClassName(this), "first mismatch in block starting at frame", blockFrame);
+                }
+
+                m_status.mismatchedBlocks++;
+            }
+
+            m_input.blocks.pop_front();
+            m_output.blocks.pop_front();
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    // Proves that the frames reaching the device are the very bytes that came in. Both sides are hashed
+    // with CRC32C in fixed frame blocks and the blocks are paired by frame position.
+    class BitPerfectCheck final
+    {
+    public:
+
+        struct Status
+        {
+            bool enabled = false;
+            bool shared = false;       // shared mode device, the system mixer processes the output further
+            bool converted = false;    // format, channels or rate differ between input and output
+            uint32_t rate = 0;
+            uint64_t verifiedFrames = 0;
+            uint64_t mismatchedBlocks = 0;
+            int64_t firstMismatchFrame = -1; // first frame of the first block that didn't match
+        };
+
+        BitPerfectCheck() = default;
+        BitPerfectCheck(const BitPerfectCheck&) = delete;
+        BitPerfectCheck& operator=(const BitPerfectCheck&) = delete;
+
+        void Initialize(bool enable);
+        bool IsEnabled() const { return m_status.enabled; }
+
+        // Starts a new pairing, for when the stream is interrupted (flush, device change).
+        void Reset();
+
+        void Input(DspChunk& chunk);
+        void Output(DspChunk& chunk, DspFormat deviceFormat, bool exclusive);
+
+        Status GetStatus() const { return m_status; }
+
+        static uint32_t Crc32c(uint32_t crc, const char* data, size_t size);
+
+    private:
+
+        enum
+        {
+            BlockFrames = 1024,
+            MaxPendingBlocks = 1024,
+        };
+
+        struct Side
+        {
+            DspFormat format = DspFormat::Unknown;
+            uint32_t channels = 0;
+            uint32_t rate = 0;
+            uint64_t frames = 0;
+            uint32_t crc = 0xFFFFFFFF;
+            std::deque<uint32_t> blocks;
+        };
+
+        void Hash(Side& side, DspChunk& chunk);
+        void Compare();
+
+        Status m_status;
+
+        Side m_input;
+        Side m_output;
+        uint64_t m_outputBase = 0; // Output frames hashed before the last reset.
+    };
+}
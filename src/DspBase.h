@@ -1,20 +1,61 @@
-#pragma once
-
-#include "DspChunk.h"
-
-namespace SaneAudioRenderer
-{
-    class DspBase
-    {
-    public:
-
-        virtual ~DspBase() = default;
-
-        virtual std::wstring Name() = 0;
-
-        virtual bool Active() = 0;
-
-        virtual void Process(DspChunk& chunk) = 0;
-        virtual void Finish(DspChunk& chunk) = 0;
-    };
-}
+#pragma once
+
+#include "DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    class DspBase
+    {
+    public:
+
+        virtual ~DspBase() = default;
+
+        virtual std::wstring Name() = 0;
+
+        virtual bool Active() = 0;
+
+        virtual void Process(DspChunk& chunk) = 0;
+        virtual void Finish(DspChunk& chunk) = 0;
+
+        // Hash of the parameters the stage was last initialized with, zero forces the next initialization.
+        uint64_t GetConfigHash() const { return m_configHash; }
+        void InvalidateConfig() { m_configHash = 0; }
+
+    protected:
+
+        // Called first thing in Initialize(), false means the parameters didn't change
+        // and the stage can keep its state and buffers as they are.
+        template <typename... T>
+        bool UpdateConfig(const T&... params)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            HashConfig(hash, params...);
+            hash |= 1;
+
+            if (hash == m_configHash)
+                return false;
+
+            m_configHash = hash;
+            return true;
+        }
+
+    private:
+
+        static void HashConfig(uint64_t&) {}
+
+        template <typename T0, typename... T>
+        static void HashConfig(uint64_t& hash, const T0& param, const T&... params)
+        {
+            static_assert(std::is_scalar<T0>::value, "Only plain values are hashed as bytes");
+
+            // FNV-1a.
+            auto data = reinterpret_cast<const uint8_t*>(&param);
+            for (size_t i = 0; i < sizeof(T0); i++)
+                hash = (hash ^ data[i]) * 1099511628211ull;
+
+            HashConfig(hash, params...);
+        }
+
+        uint64_t m_configHash = 0;
+    };
+}
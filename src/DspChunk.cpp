@@ -1,490 +1,849 @@
-#include "pch.h"
-#include "DspChunk.h"
-
-namespace SaneAudioRenderer
-{
-    static_assert((int32_t{-1} >> 31) == -1 && (int64_t{-1} >> 63) == -1, "Code relies on right signed shift UB");
-    static_assert((int32_t)(double)INT32_MAX == INT32_MAX, "Rounding error");
-    static_assert((int32_t)(double)(INT32_MAX - 1) == (INT32_MAX - 1), "Rounding error");
-
-    namespace
-    {
-        __forceinline int32_t UnpackPcm24(const int24_t& input)
-        {
-            uint32_t x = *(reinterpret_cast<const uint16_t*>(&input));
-            uint32_t h = *(reinterpret_cast<const uint8_t*>(&input) + 2);
-            x |= (h << 16);
-            x <<= 8;
-            return x;
-        }
-
-        __forceinline void PackPcm24(const int32_t& input, int24_t& output)
-        {
-             *(reinterpret_cast<uint16_t*>(&output)) = (uint16_t)(input >> 8);
-             *(reinterpret_cast<uint8_t*>(&output) + 2) = (uint8_t)(input >> 24);
-        }
-
-        template <DspFormat InputFormat, DspFormat OutputFormat>
-        __forceinline void ConvertSample(const typename DspFormatTraits<InputFormat>::SampleType& input,
-                                         typename DspFormatTraits<OutputFormat>::SampleType& output);
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm8>(const uint8_t& input, uint8_t& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm16>(const uint8_t& input, int16_t& output)
-        {
-            output = ((int16_t)input - 0x80) << 8;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm24>(const uint8_t& input, int24_t& output)
-        {
-            PackPcm24(((int32_t)input - 0x80) << 24, output);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm32>(const uint8_t& input, int32_t& output)
-        {
-            output = ((int32_t)input - 0x80) << 24;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Float>(const uint8_t& input, float& output)
-        {
-            output = ((int32_t)input - 0x80) / ((float)INT8_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Double>(const uint8_t& input, double& output)
-        {
-            output = ((int32_t)input - 0x80) / ((double)INT8_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm16>(const int16_t& input, int16_t& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm24>(const int16_t& input, int24_t& output)
-        {
-            PackPcm24((int32_t)input << 16, output);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm32>(const int16_t& input, int32_t& output)
-        {
-            output = (int32_t)input << 16;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Float>(const int16_t& input, float& output)
-        {
-            output = (float)input / ((int32_t)INT16_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Double>(const int16_t& input, double& output)
-        {
-            output = (double)input / ((int32_t)INT16_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm16>(const int24_t &input, int16_t& output)
-        {
-            output = *(int16_t*)(input.d + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm24>(const int24_t& input, int24_t& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm32>(const int24_t& input, int32_t& output)
-        {
-            output = UnpackPcm24(input);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Float>(const int24_t& input, float& output)
-        {
-            output = (float)((double)UnpackPcm24(input) / ((uint32_t)INT32_MAX + 1));
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Double>(const int24_t& input, double& output)
-        {
-            output = (double)UnpackPcm24(input) / ((uint32_t)INT32_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm16>(const int32_t& input, int16_t& output)
-        {
-            output = (int16_t)(input >> 16);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm24>(const int32_t& input, int24_t& output)
-        {
-            PackPcm24(input, output);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm32>(const int32_t& input, int32_t& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Float>(const int32_t& input, float& output)
-        {
-            output = (float)((double)input / ((uint32_t)INT32_MAX + 1));
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Double>(const int32_t& input, double& output)
-        {
-            output = (double)input / ((uint32_t)INT32_MAX + 1);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm16>(const float& input, int16_t& output)
-        {
-            output = (int16_t)(input * INT16_MAX);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm24>(const float& input, int24_t& output)
-        {
-            PackPcm24((int32_t)((double)input * INT32_MAX), output);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm32>(const float& input, int32_t& output)
-        {
-            output = (int32_t)((double)input * INT32_MAX);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Float>(const float& input, float& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Double>(const float& input, double& output)
-        {
-            output = input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm16>(const double& input, int16_t& output)
-        {
-            output = (int16_t)(input * INT16_MAX);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm24>(const double& input, int24_t& output)
-        {
-            PackPcm24((int32_t)(input * INT32_MAX), output);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm32>(const double& input, int32_t& output)
-        {
-            output = (int32_t)(input * INT32_MAX);
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Float>(const double& input, float& output)
-        {
-            output = (float)input;
-        }
-
-        template <>
-        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Double>(const double& input, double& output)
-        {
-            output = input;
-        }
-
-        template <DspFormat InputFormat, DspFormat OutputFormat>
-        void ConvertSamples(const char* input, typename DspFormatTraits<OutputFormat>::SampleType* output, size_t samples)
-        {
-            auto inputData = reinterpret_cast<const DspFormatTraits<InputFormat>::SampleType*>(input);
-
-            for (size_t i = 0; i < samples; i++)
-                ConvertSample<InputFormat, OutputFormat>(inputData[i], output[i]);
-        }
-
-        template <DspFormat OutputFormat>
-        void ConvertChunk(DspChunk& chunk)
-        {
-            const DspFormat inputFormat = chunk.GetFormat();
-
-            assert(!chunk.IsEmpty() && OutputFormat != inputFormat);
-
-            DspChunk outputChunk(OutputFormat, chunk.GetChannelCount(), chunk.GetFrameCount(), chunk.GetRate());
-            auto outputData = reinterpret_cast<DspFormatTraits<OutputFormat>::SampleType*>(outputChunk.GetData());
-
-            switch (inputFormat)
-            {
-                case DspFormat::Pcm8:
-                    ConvertSamples<DspFormat::Pcm8, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-
-                case DspFormat::Pcm16:
-                    ConvertSamples<DspFormat::Pcm16, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-
-                case DspFormat::Pcm24:
-                    ConvertSamples<DspFormat::Pcm24, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-
-                case DspFormat::Pcm24in32:
-                case DspFormat::Pcm32:
-                    ConvertSamples<DspFormat::Pcm32, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-
-                case DspFormat::Float:
-                    ConvertSamples<DspFormat::Float, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-
-                case DspFormat::Double:
-                    ConvertSamples<DspFormat::Double, OutputFormat>(chunk.GetData(), outputData, chunk.GetSampleCount());
-                    break;
-            }
-
-            chunk = std::move(outputChunk);
-        }
-    }
-
-    void DspChunk::ToFormat(DspFormat format, DspChunk& chunk)
-    {
-        assert(format != DspFormat::Pcm8);
-
-        if (chunk.IsEmpty() || format == chunk.GetFormat())
-            return;
-
-        assert(chunk.GetFormat() != DspFormat::Unknown);
-
-        switch (format)
-        {
-            case DspFormat::Pcm16:
-                ConvertChunk<DspFormat::Pcm16>(chunk);
-                break;
-
-            case DspFormat::Pcm24:
-                ConvertChunk<DspFormat::Pcm24>(chunk);
-                break;
-
-            case DspFormat::Pcm24in32:
-                if (chunk.GetFormat() != DspFormat::Pcm32)
-                    ConvertChunk<DspFormat::Pcm32>(chunk);
-                chunk.m_format = DspFormat::Pcm24in32;
-                break;
-
-            case DspFormat::Pcm32:
-                ConvertChunk<DspFormat::Pcm32>(chunk);
-                break;
-
-            case DspFormat::Float:
-                ConvertChunk<DspFormat::Float>(chunk);
-                break;
-
-            case DspFormat::Double:
-                ConvertChunk<DspFormat::Double>(chunk);
-                break;
-        }
-    }
-
-    void DspChunk::MergeChunks(DspChunk& chunk, DspChunk& appendage)
-    {
-        if (!chunk.IsEmpty())
-        {
-            if (!appendage.IsEmpty())
-            {
-                assert(chunk.GetChannelCount() == appendage.GetChannelCount());
-                assert(chunk.GetRate() == appendage.GetRate());
-
-                ToFormat(chunk.GetFormat(), appendage);
-
-                DspChunk output(chunk.GetFormat(), chunk.GetChannelCount(),
-                                chunk.GetFrameCount() + appendage.GetFrameCount(), chunk.GetRate());
-
-                memcpy(output.GetData(), chunk.GetData(), chunk.GetSize());
-                memcpy(output.GetData() + chunk.GetSize(), appendage.GetData(), appendage.GetSize());
-
-                chunk = std::move(output);
-                appendage = {};
-            }
-        }
-        else if (!appendage.IsEmpty())
-        {
-            chunk = std::move(appendage);
-        }
-    }
-
-    DspChunk::DspChunk()
-        : m_format(DspFormat::Unknown)
-        , m_formatSize(1)
-        , m_channels(1)
-        , m_rate(1)
-        , m_dataSize(0)
-        , m_mediaData(nullptr)
-        , m_dataOffset(0)
-    {
-    }
-
-    DspChunk::DspChunk(DspFormat format, uint32_t channels, size_t frames, uint32_t rate)
-        : m_format(format)
-        , m_formatSize(DspFormatSize(m_format))
-        , m_channels(channels)
-        , m_rate(rate)
-        , m_dataSize(m_formatSize * channels * frames)
-        , m_mediaData(nullptr)
-        , m_dataOffset(0)
-    {
-        assert(m_format != DspFormat::Unknown);
-        Allocate();
-    }
-
-    DspChunk::DspChunk(IMediaSample* pSample, const AM_SAMPLE2_PROPERTIES& sampleProps, const WAVEFORMATEX& sampleFormat)
-        : m_mediaSample(pSample)
-        , m_format(DspFormatFromWaveFormat(sampleFormat))
-        , m_formatSize(m_format != DspFormat::Unknown ? DspFormatSize(m_format) : sampleFormat.wBitsPerSample / 8)
-        , m_channels(sampleFormat.nChannels)
-        , m_rate(sampleFormat.nSamplesPerSec)
-        , m_dataSize(sampleProps.lActual)
-        , m_mediaData((char*)sampleProps.pbBuffer)
-        , m_dataOffset(0)
-    {
-        assert(m_formatSize == sampleFormat.wBitsPerSample / 8);
-        assert(m_mediaSample);
-        assert(m_mediaData);
-
-        assert(m_dataSize % GetFrameSize() == 0);
-        m_dataSize = m_dataSize - m_dataSize % GetFrameSize();
-    }
-
-    DspChunk::DspChunk(DspChunk&& other)
-        : m_mediaSample(other.m_mediaSample)
-        , m_format(other.m_format)
-        , m_formatSize(other.m_formatSize)
-        , m_channels(other.m_channels)
-        , m_rate(other.m_rate)
-        , m_dataSize(other.m_dataSize)
-        , m_mediaData(other.m_mediaData)
-        , m_dataOffset(other.m_dataOffset)
-    {
-        other.m_mediaSample = nullptr;
-        std::swap(m_data, other.m_data);
-        other.m_dataSize = 0;
-    }
-
-    DspChunk& DspChunk::operator=(DspChunk&& other)
-    {
-        if (this != &other)
-        {
-            m_mediaSample = other.m_mediaSample; other.m_mediaSample = nullptr;
-            m_format = other.m_format;
-            m_formatSize = other.m_formatSize;
-            m_channels = other.m_channels;
-            m_rate = other.m_rate;
-            m_dataSize = other.m_dataSize; other.m_dataSize = 0;
-            m_mediaData = other.m_mediaData;
-            m_data = nullptr; std::swap(m_data, other.m_data);
-            m_dataOffset = other.m_dataOffset;
-        }
-        return *this;
-    }
-
-    void DspChunk::PadTail(size_t padFrames)
-    {
-        if (padFrames == 0)
-            return;
-
-        size_t newBytes = padFrames * GetFrameSize();
-
-        {
-            DspChunk tempChunk(GetFormat(), GetChannelCount(), GetFrameCount() + padFrames, GetRate());
-            memcpy(tempChunk.GetData(), GetData(), GetSize());
-            *this = std::move(tempChunk);
-        }
-
-        assert(GetSize() >= newBytes);
-        ZeroMemory(GetData() + GetSize() - newBytes, newBytes);
-    }
-
-    void DspChunk::PadHead(size_t padFrames)
-    {
-        if (padFrames == 0)
-            return;
-
-        size_t newBytes = padFrames * GetFrameSize();
-
-        if (padFrames <= m_dataOffset)
-        {
-            m_dataOffset -= padFrames;
-            m_dataSize += newBytes;
-        }
-        else
-        {
-            DspChunk tempChunk(GetFormat(), GetChannelCount(), GetFrameCount() + padFrames, GetRate());
-            memcpy(tempChunk.GetData() + newBytes, GetData(), GetSize());
-            *this = std::move(tempChunk);
-        }
-
-        assert(GetSize() >= newBytes);
-        ZeroMemory(GetData(), newBytes);
-    }
-
-    void DspChunk::ShrinkTail(size_t toFrames)
-    {
-        if (toFrames < GetFrameCount())
-            m_dataSize = GetFormatSize() * GetChannelCount() * toFrames;
-    }
-
-    void DspChunk::ShrinkHead(size_t toFrames)
-    {
-        const size_t frameCount = GetFrameCount();
-        if (toFrames < frameCount)
-        {
-            size_t shrinkBytes = (frameCount - toFrames) * GetFormatSize() * GetChannelCount();
-            m_dataOffset += shrinkBytes;
-            assert(m_dataSize >= shrinkBytes);
-            m_dataSize -= shrinkBytes;
-        }
-    }
-
-    void DspChunk::FreeMediaSample()
-    {
-        if (m_mediaSample)
-        {
-            assert(m_mediaData);
-            assert(!m_data);
-
-            Allocate();
-            memcpy(m_data.get(), m_mediaData, m_dataSize + m_dataOffset);
-            m_mediaData = nullptr;
-            m_mediaSample = nullptr;
-        }
-    }
-
-    void DspChunk::Allocate()
-    {
-        if (m_dataSize > 0)
-        {
-            m_data.reset((char*)_aligned_malloc(m_dataSize + m_dataOffset, 16));
-
-            if (!m_data.get())
-                throw std::bad_alloc();
-        }
-    }
-}
+#include "pch.h"
+#include "DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    static_assert((int32_t{-1} >> 31) == -1 && (int64_t{-1} >> 63) == -1, "Code relies on right signed shift UB");
+    static_assert((int32_t)(double)INT32_MAX == INT32_MAX, "Rounding error");
+    static_assert((int32_t)(double)(INT32_MAX - 1) == (INT32_MAX - 1), "Rounding error");
+
+    namespace
+    {
+        __forceinline int32_t UnpackPcm24(const int24_t& input)
+        {
+            uint32_t x = *(reinterpret_cast<const uint16_t*>(&input));
+            uint32_t h = *(reinterpret_cast<const uint8_t*>(&input) + 2);
+            x |= (h << 16);
+            x <<= 8;
+            return x;
+        }
+
+        __forceinline void PackPcm24(const int32_t& input, int24_t& output)
+        {
+             *(reinterpret_cast<uint16_t*>(&output)) = (uint16_t)(input >> 8);
+             *(reinterpret_cast<uint8_t*>(&output) + 2) = (uint8_t)(input >> 24);
+        }
+
+        template <DspFormat InputFormat, DspFormat OutputFormat>
+        __forceinline void ConvertSample(const typename DspFormatTraits<InputFormat>::SampleType&,
+                                         typename DspFormatTraits<OutputFormat>::SampleType&)
+        {
+            static_assert(InputFormat != InputFormat, "Missing sample conversion");
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm8>(const uint8_t& input, uint8_t& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm16>(const uint8_t& input, int16_t& output)
+        {
+            output = ((int16_t)input - 0x80) << 8;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm24>(const uint8_t& input, int24_t& output)
+        {
+            PackPcm24(((int32_t)input - 0x80) << 24, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm24in32>(const uint8_t& input, int32_t& output)
+        {
+            output = ((int32_t)input - 0x80) << 24;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Pcm32>(const uint8_t& input, int32_t& output)
+        {
+            output = ((int32_t)input - 0x80) << 24;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Float>(const uint8_t& input, float& output)
+        {
+            output = ((int32_t)input - 0x80) / ((float)INT8_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm8, DspFormat::Double>(const uint8_t& input, double& output)
+        {
+            output = ((int32_t)input - 0x80) / ((double)INT8_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm8>(const int16_t& input, uint8_t& output)
+        {
+            output = (uint8_t)((input >> 8) + 0x80);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm16>(const int16_t& input, int16_t& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm24>(const int16_t& input, int24_t& output)
+        {
+            PackPcm24((int32_t)input << 16, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm24in32>(const int16_t& input, int32_t& output)
+        {
+            output = (int32_t)input << 16;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Pcm32>(const int16_t& input, int32_t& output)
+        {
+            output = (int32_t)input << 16;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Float>(const int16_t& input, float& output)
+        {
+            output = (float)input / ((int32_t)INT16_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm16, DspFormat::Double>(const int16_t& input, double& output)
+        {
+            output = (double)input / ((int32_t)INT16_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm8>(const int24_t& input, uint8_t& output)
+        {
+            output = (uint8_t)((UnpackPcm24(input) >> 24) + 0x80);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm16>(const int24_t &input, int16_t& output)
+        {
+            output = (int16_t)(UnpackPcm24(input) >> 16);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm24>(const int24_t& input, int24_t& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm24in32>(const int24_t& input, int32_t& output)
+        {
+            output = UnpackPcm24(input);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Pcm32>(const int24_t& input, int32_t& output)
+        {
+            output = UnpackPcm24(input);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Float>(const int24_t& input, float& output)
+        {
+            output = (float)((double)UnpackPcm24(input) / ((uint32_t)INT32_MAX + 1));
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24, DspFormat::Double>(const int24_t& input, double& output)
+        {
+            output = (double)UnpackPcm24(input) / ((uint32_t)INT32_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm8>(const int32_t& input, uint8_t& output)
+        {
+            output = (uint8_t)((input >> 24) + 0x80);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm16>(const int32_t& input, int16_t& output)
+        {
+            output = (int16_t)(input >> 16);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm24>(const int32_t& input, int24_t& output)
+        {
+            PackPcm24(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm24in32>(const int32_t& input, int32_t& output)
+        {
+            // Same truncation as packed 24-bit, the padding byte stays zero.
+            output = input & ~0xff;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Pcm32>(const int32_t& input, int32_t& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Float>(const int32_t& input, float& output)
+        {
+            output = (float)((double)input / ((uint32_t)INT32_MAX + 1));
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm32, DspFormat::Double>(const int32_t& input, double& output)
+        {
+            output = (double)input / ((uint32_t)INT32_MAX + 1);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm8>(const float& input, uint8_t& output)
+        {
+            output = (uint8_t)((int32_t)(input * INT8_MAX) + 0x80);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm16>(const float& input, int16_t& output)
+        {
+            output = (int16_t)(input * INT16_MAX);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm24>(const float& input, int24_t& output)
+        {
+            PackPcm24((int32_t)((double)input * INT32_MAX), output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm24in32>(const float& input, int32_t& output)
+        {
+            output = (int32_t)((double)input * INT32_MAX) & ~0xff;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Pcm32>(const float& input, int32_t& output)
+        {
+            output = (int32_t)((double)input * INT32_MAX);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Float>(const float& input, float& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Float, DspFormat::Double>(const float& input, double& output)
+        {
+            output = input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm8>(const double& input, uint8_t& output)
+        {
+            output = (uint8_t)((int32_t)(input * INT8_MAX) + 0x80);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm16>(const double& input, int16_t& output)
+        {
+            output = (int16_t)(input * INT16_MAX);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm24>(const double& input, int24_t& output)
+        {
+            PackPcm24((int32_t)(input * INT32_MAX), output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm24in32>(const double& input, int32_t& output)
+        {
+            output = (int32_t)(input * INT32_MAX) & ~0xff;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Pcm32>(const double& input, int32_t& output)
+        {
+            output = (int32_t)(input * INT32_MAX);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Float>(const double& input, float& output)
+        {
+            output = (float)input;
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Double, DspFormat::Double>(const double& input, double& output)
+        {
+            output = input;
+        }
+
+        // Pcm24in32 is Pcm32 with a zero low byte, reading it is the same.
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Pcm8>(const int32_t& input, uint8_t& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Pcm8>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Pcm16>(const int32_t& input, int16_t& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Pcm16>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Pcm24>(const int32_t& input, int24_t& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Pcm24>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Pcm32>(const int32_t& input, int32_t& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Pcm32>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Float>(const int32_t& input, float& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Float>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Double>(const int32_t& input, double& output)
+        {
+            ConvertSample<DspFormat::Pcm32, DspFormat::Double>(input, output);
+        }
+
+        template <>
+        __forceinline void ConvertSample<DspFormat::Pcm24in32, DspFormat::Pcm24in32>(const int32_t& input, int32_t& output)
+        {
+            output = input;
+        }
+
+        bool HasSsse3()
+        {
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+        }
+
+        // Packed 24-bit samples are moved 8 at a time (24 bytes, two overlapping unaligned 16-byte loads),
+        // so the block converters never touch memory past the last sample.
+        __forceinline void LoadPcm24x8(const char* input, __m128i& lo, __m128i& hi)
+        {
+            const __m128i loMask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+            const __m128i hiMask = _mm_setr_epi8(-1, 4, 5, 6, -1, 7, 8, 9, -1, 10, 11, 12, -1, 13, 14, 15);
+            lo = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)), loMask);
+            hi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 8)), hiMask);
+        }
+
+        __forceinline void StorePcm24x8(const __m128i& lo, const __m128i& hi, char* output)
+        {
+            const __m128i loMask = _mm_setr_epi8(1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1);
+            const __m128i hiMask1 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 2, 3, 5);
+            const __m128i hiMask2 = _mm_setr_epi8(6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                             _mm_or_si128(_mm_shuffle_epi8(lo, loMask), _mm_shuffle_epi8(hi, hiMask1)));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(output + 16), _mm_shuffle_epi8(hi, hiMask2));
+        }
+
+        // Same rounding as the scalar path: float is widened to double before scaling.
+        __forceinline __m128i FloatToPcm32x4(const __m128& input)
+        {
+            const __m128d scale = _mm_set1_pd(INT32_MAX);
+            __m128i lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(input), scale));
+            __m128i hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(input, input)), scale));
+            return _mm_unpacklo_epi64(lo, hi);
+        }
+
+        // Returns the number of samples converted, the rest is left to the per-sample path.
+        template <DspFormat InputFormat, DspFormat OutputFormat>
+        __forceinline size_t ConvertBlocks(const char*, typename DspFormatTraits<OutputFormat>::SampleType*, size_t)
+        {
+            return 0;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm24, DspFormat::Pcm16>(const char* input, int16_t* output,
+                                                                               size_t samples)
+        {
+            const __m128i loMask = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+            const __m128i hiMask = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, 5, 6, 8, 9, 11, 12, 14, 15);
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 24)
+            {
+                __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+                __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 8));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                                 _mm_or_si128(_mm_shuffle_epi8(lo, loMask), _mm_shuffle_epi8(hi, hiMask)));
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm24, DspFormat::Pcm32>(const char* input, int32_t* output,
+                                                                               size_t samples)
+        {
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 24)
+            {
+                __m128i lo, hi;
+                LoadPcm24x8(input, lo, hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), lo);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 4), hi);
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm24, DspFormat::Float>(const char* input, float* output,
+                                                                               size_t samples)
+        {
+            // Left-aligned 24-bit values are exact in float, scaling by a power of two is exact as well.
+            const __m128 scale = _mm_set1_ps(1.0f / ((uint32_t)INT32_MAX + 1));
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 24)
+            {
+                __m128i lo, hi;
+                LoadPcm24x8(input, lo, hi);
+                _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm16, DspFormat::Pcm24>(const char* input, int24_t* output,
+                                                                               size_t samples)
+        {
+            const __m128i mask1 = _mm_setr_epi8(-1, 0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1);
+            const __m128i mask2 = _mm_setr_epi8(10, 11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1);
+
+            auto out = reinterpret_cast<char*>(output);
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 16, out += 24)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(x, mask1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), _mm_shuffle_epi8(x, mask2));
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm32, DspFormat::Pcm24>(const char* input, int24_t* output,
+                                                                               size_t samples)
+        {
+            auto out = reinterpret_cast<char*>(output);
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 32, out += 24)
+            {
+                StorePcm24x8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(input)),
+                             _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + 16)), out);
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Float, DspFormat::Pcm24>(const char* input, int24_t* output,
+                                                                               size_t samples)
+        {
+            auto in = reinterpret_cast<const float*>(input);
+            auto out = reinterpret_cast<char*>(output);
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, out += 24)
+                StorePcm24x8(FloatToPcm32x4(_mm_loadu_ps(in + i)), FloatToPcm32x4(_mm_loadu_ps(in + i + 4)), out);
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm16, DspFormat::Pcm32>(const char* input, int32_t* output,
+                                                                               size_t samples)
+        {
+            const __m128i zero = _mm_setzero_si128();
+
+            size_t i = 0;
+            for (; i + 8 <= samples; i += 8, input += 16)
+            {
+                __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), _mm_unpacklo_epi16(zero, x));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i + 4), _mm_unpackhi_epi16(zero, x));
+            }
+            return i;
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm16, DspFormat::Pcm24in32>(const char* input, int32_t* output,
+                                                                                   size_t samples)
+        {
+            return ConvertBlocks<DspFormat::Pcm16, DspFormat::Pcm32>(input, output, samples);
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm24, DspFormat::Pcm24in32>(const char* input, int32_t* output,
+                                                                                   size_t samples)
+        {
+            return ConvertBlocks<DspFormat::Pcm24, DspFormat::Pcm32>(input, output, samples);
+        }
+
+        template <>
+        __forceinline size_t ConvertBlocks<DspFormat::Pcm24in32, DspFormat::Pcm24>(const char* input, int24_t* output,
+                                                                                   size_t samples)
+        {
+            return ConvertBlocks<DspFormat::Pcm32, DspFormat::Pcm24>(input, output, samples);
+        }
+
+        typedef void(*ConvertFunction)(const char* input, char* output, size_t samples);
+
+        template <DspFormat InputFormat, DspFormat OutputFormat, bool Ssse3>
+        void ConvertSamples(const char* input, char* output, size_t samples)
+        {
+            auto inputData = reinterpret_cast<const typename DspFormatTraits<InputFormat>::SampleType*>(input);
+            auto outputData = reinterpret_cast<typename DspFormatTraits<OutputFormat>::SampleType*>(output);
+
+            size_t i = Ssse3 ? ConvertBlocks<InputFormat, OutputFormat>(input, outputData, samples) : 0;
+
+            for (; i < samples; i++)
+                ConvertSample<InputFormat, OutputFormat>(inputData[i], outputData[i]);
+        }
+
+        template <DspFormat InputFormat, DspFormat OutputFormat, bool Ssse3>
+        struct ConvertEntry
+        {
+            static ConvertFunction Get() { return &ConvertSamples<InputFormat, OutputFormat, Ssse3>; }
+        };
+
+        template <DspFormat OutputFormat, bool Ssse3>
+        struct ConvertEntry<DspFormat::Unknown, OutputFormat, Ssse3>
+        {
+            static ConvertFunction Get() { return nullptr; }
+        };
+
+        template <DspFormat InputFormat, bool Ssse3>
+        struct ConvertEntry<InputFormat, DspFormat::Unknown, Ssse3>
+        {
+            static ConvertFunction Get() { return nullptr; }
+        };
+
+        template <bool Ssse3>
+        struct ConvertEntry<DspFormat::Unknown, DspFormat::Unknown, Ssse3>
+        {
+            static ConvertFunction Get() { return nullptr; }
+        };
+
+        // Indexed by input format times FormatCount plus output format, every pair gets its own kernel.
+        const size_t FormatCount = (size_t)DspFormat::Double + 1;
+        const size_t ConvertTableSize = FormatCount * FormatCount;
+
+        typedef std::array<ConvertFunction, ConvertTableSize> ConvertTable;
+
+        // Instantiates the kernel of every pair, a pair without a sample conversion fails to compile.
+        template <bool Ssse3, size_t Index = 0>
+        struct ConvertTableFiller
+        {
+            static void Fill(ConvertTable& table)
+            {
+                const DspFormat inputFormat = (DspFormat)(Index / FormatCount);
+                const DspFormat outputFormat = (DspFormat)(Index % FormatCount);
+                table[Index] = ConvertEntry<inputFormat, outputFormat, Ssse3>::Get();
+                ConvertTableFiller<Ssse3, Index + 1>::Fill(table);
+            }
+        };
+
+        template <bool Ssse3>
+        struct ConvertTableFiller<Ssse3, ConvertTableSize>
+        {
+            static void Fill(ConvertTable&) {}
+        };
+
+    #ifndef NDEBUG
+        bool IsConvertTableComplete(const ConvertTable& table)
+        {
+            for (size_t i = 0; i < table.size(); i++)
+            {
+                if ((table[i] != nullptr) != (i / FormatCount != 0 && i % FormatCount != 0))
+                    return false;
+            }
+
+            return true;
+        }
+    #endif
+
+        ConvertTable MakeConvertTable()
+        {
+            ConvertTable table;
+
+            if (HasSsse3())
+                ConvertTableFiller<true>::Fill(table);
+            else
+                ConvertTableFiller<false>::Fill(table);
+
+            assert(IsConvertTableComplete(table));
+
+            return table;
+        }
+
+        // Settled once on load, the kernels themselves don't check the cpu.
+        // Namespace scope rather than a function-local static, the latter isn't thread-safe on v120.
+        const ConvertTable ConvertKernels = MakeConvertTable();
+
+        void ConvertData(DspFormat inputFormat, DspFormat outputFormat, const char* input, char* output, size_t samples)
+        {
+            assert(inputFormat != DspFormat::Unknown);
+            assert(outputFormat != DspFormat::Unknown);
+
+            ConvertKernels[(size_t)inputFormat * FormatCount + (size_t)outputFormat](input, output, samples);
+        }
+    }
+
+    void DspChunk::ToFormat(DspFormat format, DspChunk& chunk)
+    {
+        if (chunk.IsEmpty() || format == chunk.GetFormat())
+            return;
+
+        assert(chunk.GetFormat() != DspFormat::Unknown);
+
+        DspChunk outputChunk(format, chunk.GetChannelCount(), chunk.GetFrameCount(), chunk.GetRate());
+
+        ConvertData(chunk.GetFormat(), format, chunk.GetData(), outputChunk.GetData(), chunk.GetSampleCount());
+
+        chunk = std::move(outputChunk);
+    }
+
+    void DspChunk::ToBuffer(DspFormat format, DspChunk& chunk, size_t frames, char* pBuffer)
+    {
+        assert(frames <= chunk.GetFrameCount());
+        assert(pBuffer || frames == 0);
+
+        if (frames == 0)
+            return;
+
+        const size_t samples = frames * chunk.GetChannelCount();
+
+        // Bitstream chunks come through here too, both formats are Unknown for them.
+        if (format == chunk.GetFormat())
+        {
+            memcpy(pBuffer, chunk.GetData(), samples * chunk.GetFormatSize());
+            return;
+        }
+
+        assert(chunk.GetFormat() != DspFormat::Unknown);
+
+        ConvertData(chunk.GetFormat(), format, chunk.GetData(), pBuffer, samples);
+    }
+
+    void DspChunk::MergeChunks(DspChunk& chunk, DspChunk& appendage)
+    {
+        if (!chunk.IsEmpty())
+        {
+            if (!appendage.IsEmpty())
+            {
+                assert(chunk.GetChannelCount() == appendage.GetChannelCount());
+                assert(chunk.GetRate() == appendage.GetRate());
+
+                ToFormat(chunk.GetFormat(), appendage);
+
+                // Grows in place when the chunk has enough tail room.
+                const size_t chunkSize = chunk.GetSize();
+                chunk.PadTail(appendage.GetFrameCount());
+                memcpy(chunk.GetData() + chunkSize, appendage.GetData(), appendage.GetSize());
+
+                appendage = {};
+            }
+        }
+        else if (!appendage.IsEmpty())
+        {
+            chunk = std::move(appendage);
+        }
+    }
+
+    DspChunk::DspChunk()
+        : m_format(DspFormat::Unknown)
+        , m_formatSize(1)
+        , m_channels(1)
+        , m_rate(1)
+        , m_dataSize(0)
+        , m_mediaData(nullptr)
+        , m_dataOffset(0)
+        , m_capacity(0)
+    {
+    }
+
+    DspChunk::DspChunk(DspFormat format, uint32_t channels, size_t frames, uint32_t rate)
+        : m_format(format)
+        , m_formatSize(DspFormatSize(m_format))
+        , m_channels(channels)
+        , m_rate(rate)
+        , m_dataSize(m_formatSize * channels * frames)
+        , m_mediaData(nullptr)
+        , m_dataOffset(GetHeadroom(m_dataSize, GetFrameSize()))
+        , m_capacity(0)
+    {
+        assert(m_format != DspFormat::Unknown);
+        Allocate();
+    }
+
+    DspChunk::DspChunk(IMediaSample* pSample, const AM_SAMPLE2_PROPERTIES& sampleProps, const WAVEFORMATEX& sampleFormat)
+        : m_mediaSample(pSample)
+        , m_format(DspFormatFromWaveFormat(sampleFormat))
+        , m_formatSize(m_format != DspFormat::Unknown ? DspFormatSize(m_format) : sampleFormat.wBitsPerSample / 8)
+        , m_channels(sampleFormat.nChannels)
+        , m_rate(sampleFormat.nSamplesPerSec)
+        , m_dataSize(sampleProps.lActual)
+        , m_mediaData((char*)sampleProps.pbBuffer)
+        , m_dataOffset(0)
+        , m_capacity(0)
+    {
+        assert(m_formatSize == sampleFormat.wBitsPerSample / 8);
+        assert(m_mediaSample);
+        assert(m_mediaData);
+
+        assert(m_dataSize % GetFrameSize() == 0);
+        m_dataSize = m_dataSize - m_dataSize % GetFrameSize();
+    }
+
+    DspChunk::DspChunk(DspChunk&& other)
+        : m_mediaSample(other.m_mediaSample)
+        , m_format(other.m_format)
+        , m_formatSize(other.m_formatSize)
+        , m_channels(other.m_channels)
+        , m_rate(other.m_rate)
+        , m_dataSize(other.m_dataSize)
+        , m_mediaData(other.m_mediaData)
+        , m_dataOffset(other.m_dataOffset)
+        , m_capacity(other.m_capacity)
+    {
+        other.m_mediaSample = nullptr;
+        std::swap(m_data, other.m_data);
+        other.m_dataSize = 0;
+    }
+
+    DspChunk& DspChunk::operator=(DspChunk&& other)
+    {
+        if (this != &other)
+        {
+            m_mediaSample = other.m_mediaSample; other.m_mediaSample = nullptr;
+            m_format = other.m_format;
+            m_formatSize = other.m_formatSize;
+            m_channels = other.m_channels;
+            m_rate = other.m_rate;
+            m_dataSize = other.m_dataSize; other.m_dataSize = 0;
+            m_mediaData = other.m_mediaData;
+            m_data = nullptr; std::swap(m_data, other.m_data);
+            m_dataOffset = other.m_dataOffset;
+            m_capacity = other.m_capacity;
+        }
+        return *this;
+    }
+
+    void DspChunk::PadTail(size_t padFrames)
+    {
+        if (padFrames == 0)
+            return;
+
+        size_t newBytes = padFrames * GetFrameSize();
+
+        if (m_data && m_dataOffset + m_dataSize + newBytes <= m_capacity)
+        {
+            m_dataSize += newBytes;
+        }
+        else
+        {
+            DspChunk tempChunk(GetFormat(), GetChannelCount(), GetFrameCount() + padFrames, GetRate());
+            memcpy(tempChunk.GetData(), GetData(), GetSize());
+            *this = std::move(tempChunk);
+        }
+
+        assert(GetSize() >= newBytes);
+        ZeroMemory(GetData() + GetSize() - newBytes, newBytes);
+    }
+
+    void DspChunk::PadHead(size_t padFrames)
+    {
+        if (padFrames == 0)
+            return;
+
+        size_t newBytes = padFrames * GetFrameSize();
+
+        if (newBytes <= m_dataOffset)
+        {
+            m_dataOffset -= newBytes;
+            m_dataSize += newBytes;
+        }
+        else
+        {
+            DspChunk tempChunk(GetFormat(), GetChannelCount(), GetFrameCount() + padFrames, GetRate());
+            memcpy(tempChunk.GetData() + newBytes, GetData(), GetSize());
+            *this = std::move(tempChunk);
+        }
+
+        assert(GetSize() >= newBytes);
+        ZeroMemory(GetData(), newBytes);
+    }
+
+    void DspChunk::ShrinkTail(size_t toFrames)
+    {
+        if (toFrames < GetFrameCount())
+            m_dataSize = GetFormatSize() * GetChannelCount() * toFrames;
+    }
+
+    void DspChunk::ShrinkHead(size_t toFrames)
+    {
+        const size_t frameCount = GetFrameCount();
+        if (toFrames < frameCount)
+        {
+            size_t shrinkBytes = (frameCount - toFrames) * GetFormatSize() * GetChannelCount();
+            m_dataOffset += shrinkBytes;
+            assert(m_dataSize >= shrinkBytes);
+            m_dataSize -= shrinkBytes;
+        }
+    }
+
+    void DspChunk::FreeMediaSample()
+    {
+        if (m_mediaSample)
+        {
+            assert(m_mediaData);
+            assert(!m_data);
+
+            Allocate();
+            memcpy(m_data.get(), m_mediaData, m_dataSize + m_dataOffset);
+            m_mediaData = nullptr;
+            m_mediaSample = nullptr;
+        }
+    }
+
+    void DspChunk::Allocate()
+    {
+        if (m_dataSize > 0)
+        {
+            // Whatever the pool rounds up becomes tail room.
+            const size_t bytes = m_dataOffset + m_dataSize + GetHeadroom(m_dataSize, GetFrameSize());
+
+            uint32_t sizeClass;
+            m_data.reset(DspChunkPool::Allocate(bytes, sizeClass));
+            m_data.get_deleter().sizeClass = sizeClass;
+
+            m_capacity = (sizeClass != DspChunkPool::Unpooled) ? ((size_t)1 << sizeClass) : bytes;
+        }
+    }
+
+    size_t DspChunk::GetHeadroom(size_t bytes, uint32_t frameSize)
+    {
+        // An eighth of the chunk on each side, so small pads and merges stay in place.
+        assert(frameSize > 0);
+        return (bytes / 8 + frameSize - 1) / frameSize * frameSize;
+    }
+}
@@ -0,0 +1,163 @@
+#include "pch.h"
+#include "DspChunkPool.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        struct SizeClassList
+        {
+            std::vector<char*> buffers;
+            size_t reserved = 0;
+        };
+
+        struct PoolState
+        {
+            ~PoolState()
+            {
+                for (auto& list : lists)
+                    for (char* p : list.buffers)
+                        _aligned_free(p);
+            }
+
+            CCritSec mutex;
+            std::array<SizeClassList, DspChunkPool::MaxSizeClass + 1> lists;
+
+        #ifndef NDEBUG
+            uint32_t failureInterval = 0;
+            uint32_t failureCounter = 0;
+        #endif
+        };
+
+        PoolState& GetState()
+        {
+            static PoolState state;
+            return state;
+        }
+
+        uint32_t GetSizeClass(size_t bytes)
+        {
+            uint32_t sizeClass = DspChunkPool::MinSizeClass;
+
+            while (((size_t)1 << sizeClass) < bytes)
+            {
+                if (++sizeClass > DspChunkPool::MaxSizeClass)
+                    return DspChunkPool::Unpooled;
+            }
+
+            return sizeClass;
+        }
+
+        size_t GetRetainLimit(uint32_t sizeClass, const SizeClassList& list)
+        {
+            // Small buffers are cheap to keep around, big ones only as many as were asked for.
+            return std::max(list.reserved, (size_t)(sizeClass <= 20 ? 16 : 2));
+        }
+    }
+
+    char* DspChunkPool::Allocate(size_t bytes, uint32_t& sizeClass)
+    {
+    #ifndef NDEBUG
+        {
+            PoolState& state = GetState();
+            CAutoLock lock(&state.mutex);
+
+            if (state.failureInterval > 0 && ++state.failureCounter % state.failureInterval == 0)
+                throw std::bad_alloc();
+        }
+    #endif
+
+        sizeClass = GetSizeClass(bytes);
+
+        if (sizeClass != Unpooled)
+        {
+            PoolState& state = GetState();
+            CAutoLock lock(&state.mutex);
+
+            auto& buffers = state.lists[sizeClass].buffers;
+
+            if (!buffers.empty())
+            {
+                char* pBuffer = buffers.back();
+                buffers.pop_back();
+                return pBuffer;
+            }
+
+            bytes = (size_t)1 << sizeClass;
+        }
+
+        char* pBuffer = (char*)_aligned_malloc(bytes, 16);
+
+        if (!pBuffer)
+            throw std::bad_alloc();
+
+        return pBuffer;
+    }
+
+    void DspChunkPool::Free(char* pBuffer, uint32_t sizeClass)
+    {
+        if (!pBuffer)
+            return;
+
+        if (sizeClass != Unpooled)
+        {
+            assert(sizeClass >= MinSizeClass && sizeClass <= MaxSizeClass);
+
+            PoolState& state = GetState();
+            CAutoLock lock(&state.mutex);
+
+            auto& list = state.lists[sizeClass];
+
+            if (list.buffers.size() < GetRetainLimit(sizeClass, list))
+            {
+                try
+                {
+                    list.buffers.push_back(pBuffer);
+                    return;
+                }
+                catch (std::bad_alloc&)
+                {
+                }
+            }
+        }
+
+        _aligned_free(pBuffer);
+    }
+
+    void DspChunkPool::Reserve(size_t bytes, size_t count)
+    {
+        const uint32_t sizeClass = GetSizeClass(bytes);
+
+        if (sizeClass == Unpooled)
+            return;
+
+        PoolState& state = GetState();
+        CAutoLock lock(&state.mutex);
+
+        auto& list = state.lists[sizeClass];
+
+        list.reserved = std::max(list.reserved, count);
+        list.buffers.reserve(GetRetainLimit(sizeClass, list));
+
+        while (list.buffers.size() < count)
+        {
+            char* pBuffer = (char*)_aligned_malloc((size_t)1 << sizeClass, 16);
+
+            if (!pBuffer)
+                throw std::bad_alloc();
+
+            list.buffers.push_back(pBuffer);
+        }
+    }
+
+    #ifndef NDEBUG
+    void DspChunkPool::SetFailureInterval(uint32_t interval)
+    {
+        PoolState& state = GetState();
+        CAutoLock lock(&state.mutex);
+
+        state.failureInterval = interval;
+        state.failureCounter = 0;
+    }
+    #endif
+}
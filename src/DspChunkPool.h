@@ -0,0 +1,38 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+    // Process-wide recycler for DspChunk storage. Buffers are grouped in power-of-two size classes
+    // and kept on free lists after release, so steady-state streaming doesn't touch the heap.
+    class DspChunkPool final
+    {
+    public:
+
+        static char* Allocate(size_t bytes, uint32_t& sizeClass);
+        static void Free(char* pBuffer, uint32_t sizeClass);
+
+        static void Reserve(size_t bytes, size_t count);
+
+    #ifndef NDEBUG
+        // Fault injection, every interval-th allocation throws std::bad_alloc (0 turns it off).
+        static void SetFailureInterval(uint32_t interval);
+    #endif
+
+        enum
+        {
+            MinSizeClass = 12, // 4KiB
+            MaxSizeClass = 24, // 16MiB
+            Unpooled = 0,
+        };
+    };
+
+    struct DspChunkPoolDeleter
+    {
+        uint32_t sizeClass = DspChunkPool::Unpooled;
+
+        void operator()(char* p)
+        {
+            DspChunkPool::Free(p, sizeClass);
+        }
+    };
+}
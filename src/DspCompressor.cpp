@@ -0,0 +1,380 @@
+#include "pch.h"
+#include "DspCompressor.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        const double pi = 3.14159265358979323846;
+
+        const float lowCrossover = 200.0f;
+        const float highCrossover = 2000.0f;
+
+        const float threshold = -30.0f; // dBFS
+        const float ratio = 3.0f;
+        const float makeup = 6.0f; // dB
+
+        const float rmsWindow = 0.010f; // Seconds, same for the rest.
+        const float attackTime = 0.005f;
+        const float releaseTime = 0.200f;
+        const float lookaheadTime = 0.005f;
+
+        const size_t controlFrames = 16; // Detector and gain update period, well inside the look-ahead.
+
+        enum class BiquadType
+        {
+            Lowpass,
+            Highpass,
+            Allpass,
+        };
+
+        // b0, b1, b2, a1, a2 (normalized to a0).
+        std::array<float, 5> MakeButterworth(BiquadType type, float frequency, uint32_t rate)
+        {
+            const double w0 = 2.0 * pi * frequency / rate;
+            const double cosw0 = std::cos(w0);
+            const double alpha = std::sin(w0) / std::sqrt(2.0);
+            const double a0 = 1.0 + alpha;
+
+            double b0, b1, b2;
+
+            switch (type)
+            {
+                case BiquadType::Lowpass:
+                    b0 = (1.0 - cosw0) / 2;
+                    b1 = 1.0 - cosw0;
+                    b2 = b0;
+                    break;
+
+                case BiquadType::Highpass:
+                    b0 = (1.0 + cosw0) / 2;
+                    b1 = -(1.0 + cosw0);
+                    b2 = b0;
+                    break;
+
+                default:
+                    // Sum of a 4th order Linkwitz-Riley pair, used to keep the low band in phase with the others.
+                    b0 = 1.0 - alpha;
+                    b1 = -2.0 * cosw0;
+                    b2 = 1.0 + alpha;
+            }
+
+            return {(float)(b0 / a0), (float)(b1 / a0), (float)(b2 / a0),
+                    (float)(-2.0 * cosw0 / a0), (float)((1.0 - alpha) / a0)};
+        }
+
+        float SmoothingCoef(float time, uint32_t rate)
+        {
+            return (float)(1.0 - std::exp(-1.0 / (time * rate)));
+        }
+
+        // Transposed direct form II, one channel per lane.
+        __forceinline __m128 RunBiquad(const __m128* c, float* pState, __m128 x)
+        {
+            __m128 s1 = _mm_loadu_ps(pState);
+            __m128 s2 = _mm_loadu_ps(pState + 4);
+
+            const __m128 y = _mm_add_ps(_mm_mul_ps(c[0], x), s1);
+            s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c[1], x), _mm_mul_ps(c[3], y)), s2);
+            s2 = _mm_sub_ps(_mm_mul_ps(c[2], x), _mm_mul_ps(c[4], y));
+
+            _mm_storeu_ps(pState, s1);
+            _mm_storeu_ps(pState + 4, s2);
+
+            return y;
+        }
+
+        // Channels of one frame, lanes past the last channel are kept out of memory.
+        __forceinline __m128 LoadLanes(const float* p, size_t count)
+        {
+            switch (count)
+            {
+                case 1:
+                    return _mm_load_ss(p);
+
+                case 2:
+                    return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+
+                case 3:
+                    return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p))),
+                                         _mm_load_ss(p + 2));
+
+                default:
+                    return _mm_loadu_ps(p);
+            }
+        }
+
+        __forceinline void StoreLanes(float* p, size_t count, __m128 x)
+        {
+            switch (count)
+            {
+                case 1:
+                    _mm_store_ss(p, x);
+                    break;
+
+                case 3:
+                    _mm_store_ss(p + 2, _mm_movehl_ps(x, x));
+                    // Fall through.
+
+                case 2:
+                    _mm_store_sd(reinterpret_cast<double*>(p), _mm_castps_pd(x));
+                    break;
+
+                default:
+                    _mm_storeu_ps(p, x);
+            }
+        }
+
+        __forceinline float HorizontalMax(__m128 x)
+        {
+            x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+            x = _mm_max_ss(x, _mm_shuffle_ps(x, x, 1));
+            return _mm_cvtss_f32(x);
+        }
+    }
+
+    void DspCompressor::Initialize(ISettings* pSettings, uint32_t rate, uint32_t channels)
+    {
+        assert(pSettings);
+
+        if (!UpdateConfig(pSettings, rate, channels))
+            return;
+
+        m_settings = pSettings;
+
+        m_rate = rate;
+        m_channels = channels;
+        m_lanes = (channels + 3) / 4 * 4;
+
+        m_possible = (channels > 0 && rate >= 8000);
+
+        m_active = false;
+        m_draining = false;
+
+        if (m_possible)
+        {
+            m_filters[0] = m_filters[1] = MakeButterworth(BiquadType::Lowpass, lowCrossover, rate);
+            m_filters[2] = m_filters[3] = MakeButterworth(BiquadType::Highpass, lowCrossover, rate);
+            m_filters[4] = MakeButterworth(BiquadType::Allpass, highCrossover, rate);
+            m_filters[5] = m_filters[6] = MakeButterworth(BiquadType::Lowpass, highCrossover, rate);
+            m_filters[7] = m_filters[8] = MakeButterworth(BiquadType::Highpass, highCrossover, rate);
+
+            m_powerCoef = SmoothingCoef(rmsWindow, rate);
+            // Gain smoothing steps once per control block.
+            m_attackCoef = SmoothingCoef(attackTime / controlFrames, rate);
+            m_releaseCoef = SmoothingCoef(releaseTime / controlFrames, rate);
+
+            m_lookahead = std::max<size_t>(1, (size_t)(lookaheadTime * rate));
+
+            m_filterState.resize(m_lanes * Filters * 2);
+            m_delay.resize(m_lanes * Bands * m_lookahead);
+            m_power.resize(m_lanes * Bands);
+
+            UpdateSettings();
+        }
+    }
+
+    bool DspCompressor::Active()
+    {
+        return m_active;
+    }
+
+    void DspCompressor::Process(DspChunk& chunk)
+    {
+        if (m_settingsSerial != m_settings->GetSerial())
+            UpdateSettings();
+
+        if (m_draining)
+        {
+            // Switched off, let out what is still held in the look-ahead delay.
+            m_draining = false;
+
+            DspChunk output = Drain();
+            DspChunk::MergeChunks(output, chunk);
+            chunk = std::move(output);
+            return;
+        }
+
+        if (!m_active || chunk.IsEmpty())
+            return;
+
+        assert(chunk.GetChannelCount() == m_channels);
+
+        DspChunk::ToFloat(chunk);
+
+        const size_t frames = chunk.GetFrameCount();
+
+        ProcessFrames(reinterpret_cast<float*>(chunk.GetData()), frames);
+
+        // The delay starts out filled with silence, don't let it through.
+        if (m_skipFrames > 0)
+        {
+            const size_t skipFrames = std::min(m_skipFrames, frames);
+            chunk.ShrinkHead(frames - skipFrames);
+            m_skipFrames -= skipFrames;
+        }
+    }
+
+    void DspCompressor::Finish(DspChunk& chunk)
+    {
+        Process(chunk);
+
+        if (m_active)
+        {
+            DspChunk output = Drain();
+            DspChunk::MergeChunks(chunk, output);
+            Reset();
+        }
+    }
+
+    void DspCompressor::UpdateSettings()
+    {
+        m_settingsSerial = m_settings->GetSerial();
+
+        const bool wasActive = m_active;
+
+        m_active = m_possible && m_settings->GetCompressorEnabled();
+
+        if (m_active && !wasActive)
+        {
+            Reset();
+            m_draining = false;
+        }
+        else if (!m_active && wasActive)
+        {
+            m_draining = true;
+        }
+    }
+
+    void DspCompressor::Reset()
+    {
+        std::fill(m_filterState.begin(), m_filterState.end(), 0.0f);
+        std::fill(m_delay.begin(), m_delay.end(), 0.0f);
+        std::fill(m_power.begin(), m_power.end(), 0.0f);
+        m_level.fill(0.0f);
+        m_gain.fill(0.0f);
+        m_rampStart.fill(1.0f);
+        m_rampEnd.fill(1.0f);
+        m_rampStep.fill(0.0f);
+
+        m_controlPosition = 0;
+
+        m_delayPosition = 0;
+        m_skipFrames = m_lookahead;
+    }
+
+    void DspCompressor::ProcessFrames(float* pData, size_t frames)
+    {
+        // Filter tails decay into denormals on silence, flush them to zero while we're here.
+        const unsigned csr = _mm_getcsr();
+        _mm_setcsr(csr | 0x8040);
+
+        __m128 coefs[Filters][5];
+        for (size_t i = 0; i < Filters; i++)
+        {
+            for (size_t j = 0; j < 5; j++)
+                coefs[i][j] = _mm_set1_ps(m_filters[i][j]);
+        }
+
+        const __m128 powerCoef = _mm_set1_ps(m_powerCoef);
+
+        // Loudest power of the control block so far, per lane.
+        __m128 level[Bands];
+        for (size_t band = 0; band < Bands; band++)
+            level[band] = _mm_set1_ps(m_level[band]);
+
+        for (size_t frame = 0; frame < frames; frame++)
+        {
+            float* pFrame = pData + frame * m_channels;
+
+            __m128 gain[Bands];
+            for (size_t band = 0; band < Bands; band++)
+                gain[band] = _mm_set1_ps(m_rampStart[band] + m_rampStep[band] * (float)m_controlPosition);
+
+            for (size_t lane = 0; lane < m_lanes; lane += 4)
+            {
+                const size_t laneChannels = std::min<size_t>(4, m_channels - lane);
+                float* pState = m_filterState.data() + lane * Filters * 2;
+
+                const __m128 x = LoadLanes(pFrame + lane, laneChannels);
+
+                __m128 low = RunBiquad(coefs[0], pState, x);
+                low = RunBiquad(coefs[1], pState + 8, low);
+                low = RunBiquad(coefs[4], pState + 32, low);
+
+                __m128 rest = RunBiquad(coefs[2], pState + 16, x);
+                rest = RunBiquad(coefs[3], pState + 24, rest);
+
+                __m128 mid = RunBiquad(coefs[5], pState + 40, rest);
+                mid = RunBiquad(coefs[6], pState + 48, mid);
+
+                __m128 high = RunBiquad(coefs[7], pState + 56, rest);
+                high = RunBiquad(coefs[8], pState + 64, high);
+
+                const __m128 bands[Bands] = {low, mid, high};
+                __m128 output = _mm_setzero_ps();
+
+                for (size_t band = 0; band < Bands; band++)
+                {
+                    float* pPower = m_power.data() + band * m_lanes + lane;
+                    __m128 power = _mm_loadu_ps(pPower);
+                    power = _mm_add_ps(power, _mm_mul_ps(powerCoef, _mm_sub_ps(_mm_mul_ps(bands[band], bands[band]), power)));
+                    _mm_storeu_ps(pPower, power);
+                    level[band] = _mm_max_ps(level[band], power);
+
+                    float* pDelay = m_delay.data() + (band * m_lookahead + m_delayPosition) * m_lanes + lane;
+                    const __m128 delayed = _mm_loadu_ps(pDelay);
+                    _mm_storeu_ps(pDelay, bands[band]);
+
+                    output = _mm_add_ps(output, _mm_mul_ps(delayed, gain[band]));
+                }
+
+                StoreLanes(pFrame + lane, laneChannels, output);
+            }
+
+            m_delayPosition = (m_delayPosition + 1) % m_lookahead;
+
+            if (++m_controlPosition < controlFrames)
+                continue;
+
+            m_controlPosition = 0;
+
+            // Channels are linked, the loudest one drives the band gain. The gain ramps to its new value over
+            // the next block, the look-ahead makes that block of lag irrelevant.
+            for (size_t band = 0; band < Bands; band++)
+            {
+                const float levelDb = 10.0f * std::log10(HorizontalMax(level[band]) + 1e-10f);
+                const float over = std::max(0.0f, levelDb - threshold);
+                const float target = makeup - over * (1.0f - 1.0f / ratio);
+
+                m_gain[band] += (target < m_gain[band] ? m_attackCoef : m_releaseCoef) * (target - m_gain[band]);
+
+                m_rampStart[band] = m_rampEnd[band];
+                m_rampEnd[band] = std::pow(10.0f, m_gain[band] / 20);
+                m_rampStep[band] = (m_rampEnd[band] - m_rampStart[band]) / controlFrames;
+
+                level[band] = _mm_setzero_ps();
+            }
+        }
+
+        // The control block carries over into the next chunk.
+        for (size_t band = 0; band < Bands; band++)
+            m_level[band] = HorizontalMax(level[band]);
+
+        _mm_setcsr(csr);
+    }
+
+    DspChunk DspCompressor::Drain()
+    {
+        DspChunk chunk(DspFormat::Float, m_channels, m_lookahead, m_rate);
+        ZeroMemory(chunk.GetData(), chunk.GetSize());
+
+        ProcessFrames(reinterpret_cast<float*>(chunk.GetData()), m_lookahead);
+
+        const size_t skipFrames = std::min(m_skipFrames, m_lookahead);
+        chunk.ShrinkHead(m_lookahead - skipFrames);
+        m_skipFrames = 0;
+
+        return chunk;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "DspBase.h"
+#include "Interfaces.h"
+
+namespace SaneAudioRenderer
+{
+    // Three band "night mode" compressor. Bands are split with 4th order Linkwitz-Riley crossovers,
+    // levels are RMS, linked across channels, and gain changes are applied a few milliseconds ahead
+    // of the transients. Channels are processed four at a time in SSE lanes. Levels are checked and
+    // gains updated once per 16 frames, with the gain ramped linearly in between.
+    class DspCompressor final
+        : public DspBase
+    {
+    public:
+
+        DspCompressor() = default;
+        DspCompressor(const DspCompressor&) = delete;
+        DspCompressor& operator=(const DspCompressor&) = delete;
+
+        void Initialize(ISettings* pSettings, uint32_t rate, uint32_t channels);
+
+        std::wstring Name() override { return L"Compressor"; }
+
+        bool Active() override;
+
+        void Process(DspChunk& chunk) override;
+        void Finish(DspChunk& chunk) override;
+
+    private:
+
+        enum
+        {
+            Bands = 3,
+            Filters = 9,
+        };
+
+        void UpdateSettings();
+        void Reset();
+
+        void ProcessFrames(float* pData, size_t frames);
+        DspChunk Drain();
+
+        ISettingsPtr m_settings;
+        UINT32 m_settingsSerial = 0;
+
+        uint32_t m_rate = 0;
+        uint32_t m_channels = 0;
+        size_t m_lanes = 0; // Channels rounded up to a multiple of four.
+
+        bool m_possible = false;
+        bool m_active = false;
+        bool m_draining = false;
+
+        std::array<std::array<float, 5>, Filters> m_filters;
+        std::vector<float> m_filterState;
+
+        size_t m_lookahead = 0;
+        size_t m_delayPosition = 0;
+        size_t m_skipFrames = 0;
+        std::vector<float> m_delay;
+
+        std::vector<float> m_power;
+        std::array<float, Bands> m_level; // Loudest power in the control block so far.
+        std::array<float, Bands> m_gain; // dB
+        std::array<float, Bands> m_rampStart;
+        std::array<float, Bands> m_rampEnd;
+        std::array<float, Bands> m_rampStep;
+        size_t m_controlPosition = 0;
+        float m_powerCoef = 0.0f;
+        float m_attackCoef = 0.0f;
+        float m_releaseCoef = 0.0f;
+    };
+}
@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "DspDrift.h"
+
+namespace SaneAudioRenderer
+{
+    void DspDrift::Initialize(uint32_t rate, uint32_t channels)
+    {
+        if (!UpdateConfig(rate, channels))
+            return;
+
+        m_rate = rate;
+        m_channels = channels;
+
+        m_budget = 0.0;
+        m_adjustTime = 0;
+    }
+
+    bool DspDrift::Active()
+    {
+        return m_rate > 0 && TimeToFrames(std::abs(m_adjustTime), m_rate) > 0;
+    }
+
+    void DspDrift::Process(DspChunk& chunk)
+    {
+        if (chunk.IsEmpty() || !Active())
+            return;
+
+        assert(chunk.GetRate() == m_rate);
+        assert(chunk.GetChannelCount() == m_channels);
+
+        const size_t frames = chunk.GetFrameCount();
+
+        // Spread the corrections evenly over time, the fractional part carries over to the next chunk.
+        m_budget += frames * (double)MaxPpm / 1000000;
+
+        size_t count = TimeToFrames(std::abs(m_adjustTime), m_rate);
+        count = std::min(count, (size_t)m_budget);
+        count = std::min(count, frames / 16);
+
+        m_budget = std::min(m_budget - count, 1.0);
+
+        if (count == 0)
+            return;
+
+        DspChunk::ToFloat(chunk);
+
+        const auto data = reinterpret_cast<const float*>(chunk.GetData());
+        const size_t segment = frames / count;
+
+        // One correction per segment, between the two adjacent frames with the lowest energy.
+        m_positions.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            float minEnergy = std::numeric_limits<float>::max();
+
+            for (size_t frame = i * segment, end = frame + segment - 1; frame < end; frame++)
+            {
+                float energy = 0.0f;
+
+                for (size_t sample = frame * m_channels, last = sample + m_channels * 2; sample < last; sample++)
+                    energy += data[sample] * data[sample];
+
+                if (energy < minEnergy)
+                {
+                    minEnergy = energy;
+                    m_positions[i] = frame;
+                }
+            }
+        }
+
+        if (m_adjustTime > 0)
+        {
+            InsertFrames(chunk, m_positions);
+            m_adjustTime -= FramesToTime(count, m_rate);
+        }
+        else
+        {
+            DeleteFrames(chunk, m_positions);
+            m_adjustTime += FramesToTime(count, m_rate);
+        }
+    }
+
+    void DspDrift::Finish(DspChunk& chunk)
+    {
+        Process(chunk);
+    }
+
+    void DspDrift::Adjust(REFERENCE_TIME time)
+    {
+        m_adjustTime += time;
+    }
+
+    REFERENCE_TIME DspDrift::TakePendingTime()
+    {
+        REFERENCE_TIME time = m_adjustTime;
+        m_adjustTime = 0;
+        return time;
+    }
+
+    void DspDrift::InsertFrames(DspChunk& chunk, const std::vector<size_t>& positions)
+    {
+        const size_t channels = m_channels;
+        size_t end = chunk.GetFrameCount();
+
+        chunk.PadTail(positions.size());
+
+        auto data = reinterpret_cast<float*>(chunk.GetData());
+
+        // Walk backwards so every frame moves only once.
+        for (size_t i = positions.size(); i-- > 0;)
+        {
+            const size_t frame = positions[i] + 1;
+            assert(frame < end);
+
+            memmove(data + (frame + i + 1) * channels, data + frame * channels, (end - frame) * channels * sizeof(float));
+
+            const float* pPrev = data + (frame - 1) * channels;
+            const float* pNext = data + (frame + i + 1) * channels;
+            float* pInserted = data + (frame + i) * channels;
+
+            for (size_t channel = 0; channel < channels; channel++)
+                pInserted[channel] = (pPrev[channel] + pNext[channel]) * 0.5f;
+
+            end = frame;
+        }
+    }
+
+    void DspDrift::DeleteFrames(DspChunk& chunk, const std::vector<size_t>& positions)
+    {
+        const size_t channels = m_channels;
+        const size_t frames = chunk.GetFrameCount();
+
+        auto data = reinterpret_cast<float*>(chunk.GetData());
+
+        size_t in = 0, out = 0;
+
+        // Each removed frame is folded into its neighbour.
+        for (size_t frame : positions)
+        {
+            assert(frame >= in && frame + 1 < frames);
+
+            memmove(data + out * channels, data + in * channels, (frame - in) * channels * sizeof(float));
+            out += frame - in;
+
+            for (size_t channel = 0; channel < channels; channel++)
+            {
+                data[out * channels + channel] = (data[frame * channels + channel] +
+                                                  data[(frame + 1) * channels + channel]) * 0.5f;
+            }
+
+            out++;
+            in = frame + 2;
+        }
+
+        memmove(data + out * channels, data + in * channels, (frames - in) * channels * sizeof(float));
+        out += frames - in;
+
+        chunk.ShrinkTail(out);
+    }
+}
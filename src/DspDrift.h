@@ -0,0 +1,51 @@
+#pragma once
+
+#include "DspBase.h"
+
+namespace SaneAudioRenderer
+{
+    // Cheap corrector for ppm-level clock drift. Inserts or removes single interpolated frames
+    // at the quietest points of each chunk, no more than MaxPpm of the stream.
+    class DspDrift final
+        : public DspBase
+    {
+    public:
+
+        DspDrift() = default;
+        DspDrift(const DspDrift&) = delete;
+        DspDrift& operator=(const DspDrift&) = delete;
+
+        void Initialize(uint32_t rate, uint32_t channels);
+
+        std::wstring Name() override { return L"Drift"; }
+
+        bool Active() override;
+
+        void Process(DspChunk& chunk) override;
+        void Finish(DspChunk& chunk) override;
+
+        void Adjust(REFERENCE_TIME time);
+
+        REFERENCE_TIME GetPendingTime() const { return m_adjustTime; }
+        REFERENCE_TIME TakePendingTime();
+
+        enum
+        {
+            MaxPpm = 500,
+            MaxPendingTime = 10 * OneMillisecond,
+        };
+
+    private:
+
+        void InsertFrames(DspChunk& chunk, const std::vector<size_t>& positions);
+        void DeleteFrames(DspChunk& chunk, const std::vector<size_t>& positions);
+
+        uint32_t m_rate = 0;
+        uint32_t m_channels = 0;
+
+        double m_budget = 0.0;
+        std::vector<size_t> m_positions;
+
+        REFERENCE_TIME m_adjustTime = 0; // Negative time - less samples, positive time - more samples.
+    };
+}
@@ -1,36 +1,44 @@
-#pragma once
-
-#include "DspBase.h"
-
-namespace SaneAudioRenderer
-{
-    class DspMatrix final
-        : public DspBase
-    {
-    public:
-
-        DspMatrix() = default;
-        DspMatrix(const DspMatrix&) = delete;
-        DspMatrix& operator=(const DspMatrix&) = delete;
-
-        void Initialize(uint32_t inputChannels, DWORD inputMask,
-                        uint32_t outputChannels, DWORD outputMask);
-
-        std::wstring Name() override { return L"Matrix"; }
-
-        bool Active() override;
-
-        void Process(DspChunk& chunk) override;
-        void Finish(DspChunk& chunk) override;
-
-        static DWORD GetChannelMask(const WAVEFORMATEX& format);
-        static bool IsStereoFormat(const WAVEFORMATEX& format);
-
-    private:
-
-        std::array<float, 18 * 18> m_matrix;
-        bool m_active = false;
-        uint32_t m_inputChannels = 0;
-        uint32_t m_outputChannels = 0;
-    };
-}
+#pragma once
+
+#include "DspBase.h"
+#include "Interfaces.h"
+
+namespace SaneAudioRenderer
+{
+    class DspMatrix final
+        : public DspBase
+    {
+    public:
+
+        DspMatrix() = default;
+        DspMatrix(const DspMatrix&) = delete;
+        DspMatrix& operator=(const DspMatrix&) = delete;
+
+        void Initialize(ISettings* pSettings, uint32_t inputChannels, DWORD inputMask,
+                        uint32_t outputChannels, DWORD outputMask);
+
+        std::wstring Name() override { return L"Matrix"; }
+
+        bool Active() override;
+
+        void Process(DspChunk& chunk) override;
+        void Finish(DspChunk& chunk) override;
+
+        static DWORD GetChannelMask(const WAVEFORMATEX& format);
+        static bool IsStereoFormat(const WAVEFORMATEX& format);
+
+    private:
+
+        void UpdateSettings();
+
+        ISettingsPtr m_settings;
+        UINT32 m_settingsSerial = 0;
+
+        std::array<float, 18 * 18> m_matrix;
+        bool m_active = false;
+        uint32_t m_inputChannels = 0;
+        DWORD m_inputMask = 0;
+        uint32_t m_outputChannels = 0;
+        DWORD m_outputMask = 0;
+    };
+}
@@ -1,326 +1,399 @@
-#include "pch.h"
-#include "DspRate.h"
-
-namespace SaneAudioRenderer
-{
-    namespace
-    {
-        void DestroyBackend(soxr_t& soxr)
-        {
-            if (soxr)
-            {
-                soxr_delete(soxr);
-                soxr = nullptr;
-            }
-        }
-
-        void Crossfade(DspChunk& toChunk, DspChunk& fromChunk, size_t transitionFrames)
-        {
-            assert(!toChunk.IsEmpty());
-            assert(!fromChunk.IsEmpty());
-            assert(toChunk.GetRate() == fromChunk.GetRate());
-            assert(toChunk.GetChannelCount() == fromChunk.GetChannelCount());
-            assert(toChunk.GetFrameCount() >= transitionFrames);
-            assert(fromChunk.GetFrameCount() >= transitionFrames);
-
-            DspChunk::ToFloat(toChunk);
-            DspChunk::ToFloat(fromChunk);
-
-            const uint32_t channels = toChunk.GetChannelCount();
-
-            auto toData = reinterpret_cast<float*>(toChunk.GetData());
-            auto fromData = reinterpret_cast<float*>(fromChunk.GetData());
-
-            for (size_t frame = 0; frame < transitionFrames; frame++)
-            {
-                // Using linear curve for highly-correlated signals.
-                const float m = (float)frame / (transitionFrames + 1);
-
-                for (uint32_t channel = 0; channel < channels; channel++)
-                {
-                    size_t sample = frame * channels + channel;
-                    toData[sample] = toData[sample] * m + fromData[sample] * (1.0f - m);
-                }
-            }
-        }
-    }
-
-    DspRate::~DspRate()
-    {
-        DestroyBackends();
-    }
-
-    void DspRate::Initialize(bool variable, uint32_t inputRate, uint32_t outputRate, uint32_t channels)
-    {
-        DestroyBackends();
-
-        m_state = State::Passthrough;
-
-        m_inStateTransition = false;
-        m_transitionCorrelation = {};
-        m_transitionChunks = {};
-
-        m_inputRate = inputRate;
-        m_outputRate = outputRate;
-        m_channels = channels;
-
-        m_variableInputFrames = 0;
-        m_variableOutputFrames = 0;
-        m_variableDelay = 0;
-
-        m_adjustTime = 0;
-
-        if (variable)
-        {
-            m_state = State::Variable;
-            CreateBackend();
-            assert(m_soxrv);
-        }
-        else if (inputRate != outputRate)
-        {
-            m_state = State::Constant;
-            CreateBackend();
-            assert(m_soxrc);
-        }
-    }
-
-    bool DspRate::Active()
-    {
-        return m_state != State::Passthrough;
-    }
-
-    void DspRate::Process(DspChunk& chunk)
-    {
-        soxr_t soxr = GetBackend();
-
-        if (!soxr || chunk.IsEmpty())
-            return;
-
-        if (m_state == State::Variable && !m_inStateTransition && m_variableDelay > 0)
-        {
-            uint64_t inputPosition = llMulDiv(m_variableOutputFrames, m_inputRate, m_outputRate, 0);
-            int64_t adjustedFrames = inputPosition + m_variableDelay - m_variableInputFrames;
-
-            REFERENCE_TIME adjustTime = m_adjustTime - FramesToTimeLong(adjustedFrames, m_inputRate);
-
-            double ratio = (double)m_inputRate * 4 / (m_outputRate * (4 + (double)adjustTime / OneSecond));
-
-            // TODO: decrease jitter
-
-            soxr_set_io_ratio(m_soxrv, ratio, m_outputRate / 1000);
-        }
-
-        DspChunk output = ProcessChunk(soxr, chunk);
-
-        if (m_state == State::Variable)
-        {
-            m_variableInputFrames += chunk.GetFrameCount();
-            m_variableOutputFrames += output.GetFrameCount();
-
-            // soxr_delay() method is not implemented for variable rate conversion yet,
-            // but the delay stays more or less constant and we can calculate it in a roundabout way.
-            if (m_variableDelay == 0 && m_variableOutputFrames > 0)
-            {
-                uint64_t inputPosition = llMulDiv(m_variableOutputFrames, m_inputRate, m_outputRate, 0);
-                m_variableDelay = m_variableInputFrames - inputPosition;
-            }
-        }
-
-        FinishStateTransition(output, chunk, false);
-
-        chunk = std::move(output);
-    }
-
-    void DspRate::Finish(DspChunk& chunk)
-    {
-        soxr_t soxr = GetBackend();
-
-        if (!soxr)
-            return;
-
-        DspChunk output = ProcessEosChunk(soxr, chunk);
-
-        FinishStateTransition(output, chunk, true);
-
-        chunk = std::move(output);
-    }
-
-    void DspRate::Adjust(REFERENCE_TIME time)
-    {
-        if (m_state != State::Variable)
-        {
-            m_state = State::Variable;
-            CreateBackend();
-            assert(m_soxrv);
-
-            m_inStateTransition = true;
-        }
-
-        m_adjustTime += time;
-    }
-
-    DspChunk DspRate::ProcessChunk(soxr_t soxr, DspChunk& chunk)
-    {
-        assert(soxr);
-        assert(!chunk.IsEmpty());
-        assert(chunk.GetRate() == m_inputRate);
-        assert(chunk.GetChannelCount() == m_channels);
-
-        DspChunk::ToFloat(chunk);
-
-        size_t outputFrames = (size_t)(2 * (uint64_t)chunk.GetFrameCount() * m_outputRate / m_inputRate);
-        DspChunk output(DspFormat::Float, chunk.GetChannelCount(), outputFrames, m_outputRate);
-
-        size_t inputDone = 0;
-        size_t outputDone = 0;
-        soxr_process(soxr, chunk.GetData(), chunk.GetFrameCount(), &inputDone,
-                           output.GetData(), output.GetFrameCount(), &outputDone);
-        assert(inputDone == chunk.GetFrameCount());
-        output.ShrinkTail(outputDone);
-
-        return output;
-    }
-
-    DspChunk DspRate::ProcessEosChunk(soxr_t soxr, DspChunk& chunk)
-    {
-        assert(soxr);
-
-        DspChunk output;
-
-        if (!chunk.IsEmpty())
-            output = ProcessChunk(soxr, chunk);
-
-        for (;;)
-        {
-            DspChunk tailChunk(DspFormat::Float, m_channels, m_outputRate, m_outputRate);
-
-            size_t inputDone = 0;
-            size_t outputDo = tailChunk.GetFrameCount();
-            size_t outputDone = 0;
-            soxr_process(soxr, nullptr, 0, &inputDone,
-                               tailChunk.GetData(), outputDo, &outputDone);
-            tailChunk.ShrinkTail(outputDone);
-
-            DspChunk::MergeChunks(output, tailChunk);
-
-            if (outputDone < outputDo)
-                break;
-        }
-
-        return output;
-    }
-
-    void DspRate::FinishStateTransition(DspChunk& processedChunk, DspChunk& unprocessedChunk, bool eos)
-    {
-        if (m_inStateTransition)
-        {
-            assert(m_state == State::Variable);
-
-            DspChunk::ToFloat(processedChunk);
-            DspChunk::ToFloat(unprocessedChunk);
-
-            auto& first = m_transitionChunks.first;
-            auto& second = m_transitionChunks.second;
-
-            DspChunk::MergeChunks(first, processedChunk);
-            assert(processedChunk.IsEmpty());
-
-            if (m_soxrc)
-            {
-                // Transitioning from constant rate conversion to variable.
-                if (!m_transitionCorrelation.first)
-                    m_transitionCorrelation = {true, (size_t)std::round(soxr_delay(m_soxrc))};
-
-                if (m_transitionCorrelation.second > 0)
-                {
-                    DspChunk::MergeChunks(second, eos ? ProcessEosChunk(m_soxrc, unprocessedChunk) :
-                                                        ProcessChunk(m_soxrc, unprocessedChunk));
-                }
-                else
-                {
-                    // Nothing to flush from constant rate conversion buffer.
-                    m_inStateTransition = false;
-                }
-            }
-            else
-            {
-                // Transitioning from pass-through to variable rate conversion.
-                m_transitionCorrelation = {};
-                DspChunk::MergeChunks(second, unprocessedChunk);
-            }
-
-            // Cross-fade.
-            if (m_inStateTransition)
-            {
-                const size_t transitionFrames = m_outputRate / 1000; // 1ms
-
-                if (first.GetFrameCount() >= transitionFrames &&
-                    second.GetFrameCount() >= m_transitionCorrelation.second + transitionFrames)
-                {
-                    second.ShrinkHead(second.GetFrameCount() - m_transitionCorrelation.second);
-                    Crossfade(first, second, transitionFrames);
-                    processedChunk = std::move(first);
-                    m_inStateTransition = false;
-                }
-                else if (eos)
-                {
-                    processedChunk = std::move(second);
-                    m_inStateTransition = false;
-                }
-            }
-
-            if (!m_inStateTransition)
-            {
-                m_transitionCorrelation = {};
-                m_transitionChunks = {};
-                DestroyBackend(m_soxrc);
-            }
-        }
-
-        unprocessedChunk = {};
-    }
-
-    void DspRate::CreateBackend()
-    {
-        assert(m_state != State::Passthrough);
-        assert(m_inputRate > 0);
-        assert(m_outputRate > 0);
-        assert(m_channels > 0);
-
-        if (m_state == State::Variable)
-        {
-            assert(!m_soxrv);
-
-            auto ioSpec = soxr_io_spec(SOXR_FLOAT32_I, SOXR_FLOAT32_I);
-            auto qualitySpec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
-            m_soxrv = soxr_create(m_inputRate * 2, m_outputRate, m_channels, nullptr, &ioSpec, &qualitySpec, nullptr);
-
-            soxr_set_io_ratio(m_soxrv, (double)m_inputRate / m_outputRate, 0);
-
-            m_variableInputFrames = 0;
-            m_variableOutputFrames = 0;
-            m_variableDelay = 0;
-        }
-        else if (m_state == State::Constant)
-        {
-            assert(m_inputRate != m_outputRate);
-            assert(!m_soxrc);
-
-            auto ioSpec = soxr_io_spec(SOXR_FLOAT32_I, SOXR_FLOAT32_I);
-            auto qualitySpec = soxr_quality_spec(SOXR_HQ, 0);
-            m_soxrc = soxr_create(m_inputRate, m_outputRate, m_channels, nullptr, &ioSpec, &qualitySpec, nullptr);
-        }
-    }
-
-    soxr_t DspRate::GetBackend()
-    {
-        return (m_state == State::Constant) ? m_soxrc :
-               (m_state == State::Variable) ? m_soxrv : nullptr;
-    }
-
-    void DspRate::DestroyBackends()
-    {
-        DestroyBackend(m_soxrc);
-        DestroyBackend(m_soxrv);
-    }
-}
+#include "pch.h"
+#include "DspRate.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b)
+        {
+            while (b != 0)
+            {
+                const uint32_t r = a % b;
+                a = b;
+                b = r;
+            }
+
+            return a;
+        }
+
+        DspChunk CopyFrames(DspChunk& chunk, size_t offset, size_t frames)
+        {
+            assert(chunk.GetFormat() == DspFormat::Float);
+            assert(offset + frames <= chunk.GetFrameCount());
+
+            DspChunk output(DspFormat::Float, chunk.GetChannelCount(), frames, chunk.GetRate());
+            memcpy(output.GetData(), chunk.GetData() + offset * chunk.GetFrameSize(), frames * chunk.GetFrameSize());
+
+            return output;
+        }
+    }
+
+    DspRate::~DspRate()
+    {
+        DestroyBackends();
+    }
+
+    void DspRate::Initialize(bool variable, uint32_t inputRate, uint32_t outputRate, uint32_t channels,
+                             bool multithreaded, double speed)
+    {
+        assert(IsSpeedSupported(speed));
+
+        if (!UpdateConfig(variable, inputRate, outputRate, channels, multithreaded, speed))
+            return;
+
+        DestroyBackends();
+
+        m_state = State::Passthrough;
+
+        m_inStateTransition = false;
+
+        m_inputRate = inputRate;
+        m_outputRate = outputRate;
+        m_channels = channels;
+        m_multithreaded = multithreaded;
+        m_speed = speed;
+
+        m_variableInputFrames = 0;
+        m_variableOutputFrames = 0;
+        m_variableDelay = 0;
+        m_variableDiscardFrames = 0;
+
+        m_adjustTime = 0;
+
+        if (variable || speed != 1.0)
+        {
+            m_state = State::Variable;
+            CreateBackend();
+            assert(m_soxrv);
+        }
+        else if (inputRate != outputRate)
+        {
+            m_state = State::Constant;
+            CreateBackend();
+            assert(m_soxrc);
+        }
+    }
+
+    bool DspRate::Active()
+    {
+        return m_state != State::Passthrough;
+    }
+
+    void DspRate::Process(DspChunk& chunk)
+    {
+        if (chunk.IsEmpty())
+            return;
+
+        if (m_inStateTransition)
+        {
+            Handover(chunk);
+            return;
+        }
+
+        DspRateBackend* soxr = GetBackend();
+
+        if (!soxr)
+            return;
+
+        if (m_state == State::Variable && !m_inStateTransition && m_variableDelay > 0)
+        {
+            // Plain 64-bit arithmetic is enough here, the products won't overflow for years of playback.
+            // Speed changes can't be expressed in whole rates, those go through double.
+            uint64_t inputPosition = (m_speed == 1.0) ? m_variableOutputFrames * m_inputRate / m_outputRate :
+                                                        (uint64_t)(m_variableOutputFrames * m_speed * m_inputRate / m_outputRate);
+            int64_t adjustedFrames = inputPosition + m_variableDelay - m_variableInputFrames;
+
+            REFERENCE_TIME adjustTime = m_adjustTime - adjustedFrames * OneSecond / m_inputRate;
+
+            double ratio = m_speed * m_inputRate * 4 / (m_outputRate * (4 + (double)adjustTime / OneSecond));
+
+            // The backend is created with room for twice the nominal ratio, speed and correction share it.
+            // Past -4 seconds the denominator goes negative, that's catching up as fast as possible too.
+            const double maxRatio = 2.0 * m_inputRate / m_outputRate;
+            if (ratio <= 0.0 || ratio > maxRatio)
+                ratio = maxRatio;
+
+            // Leave the resampler alone when the controller output barely moves (below 0.1ppm).
+            if (std::abs(ratio - m_variableRatio) > m_variableRatio * 1e-7)
+            {
+                m_soxrv->SetIoRatio(ratio, m_outputRate / 1000);
+                m_variableRatio = ratio;
+            }
+        }
+
+        chunk = ProcessCounted(soxr, chunk);
+    }
+
+    void DspRate::Finish(DspChunk& chunk)
+    {
+        if (m_inStateTransition)
+        {
+            // The stream ends before the handover, drain the old conversion and be ready for the next one.
+            if (m_soxrc)
+                chunk = ProcessEosChunk(m_soxrc.get(), chunk);
+
+            m_inStateTransition = false;
+            m_soxrc = nullptr;
+            CreateBackend();
+            return;
+        }
+
+        DspRateBackend* soxr = GetBackend();
+
+        if (!soxr)
+            return;
+
+        chunk = ProcessEosChunk(soxr, chunk);
+    }
+
+    void DspRate::Adjust(REFERENCE_TIME time)
+    {
+        if (m_state != State::Variable)
+        {
+            // The variable rate resampler is created at the handover, the old conversion keeps going until then.
+            m_state = State::Variable;
+            m_inStateTransition = true;
+        }
+
+        m_adjustTime += time;
+    }
+
+    DspChunk DspRate::ProcessChunk(DspRateBackend* soxr, DspChunk& chunk)
+    {
+        assert(soxr);
+        assert(!chunk.IsEmpty());
+        assert(chunk.GetRate() == m_inputRate);
+        assert(chunk.GetChannelCount() == m_channels);
+
+        DspChunk::ToFloat(chunk);
+
+        // Size the output for the current ratio with a small margin, the rare excess is drained below.
+        const double ratio = (soxr == m_soxrv.get()) ? m_variableRatio : (double)m_inputRate / m_outputRate;
+        const size_t outputFrames = (size_t)(chunk.GetFrameCount() / ratio * 1.01) + 16;
+
+        DspChunk output(DspFormat::Float, chunk.GetChannelCount(), outputFrames, m_outputRate);
+
+        size_t outputDone = soxr->Process((const float*)chunk.GetData(), chunk.GetFrameCount(),
+                                          (float*)output.GetData(), output.GetFrameCount());
+
+        while (outputDone == output.GetFrameCount())
+        {
+            const size_t extraFrames = outputFrames / 4 + 16;
+
+            output.PadTail(extraFrames);
+
+            outputDone += soxr->Process((const float*)chunk.GetData(), 0,
+                                        (float*)output.GetData() + outputDone * m_channels, extraFrames);
+        }
+
+        output.ShrinkTail(outputDone);
+
+        return output;
+    }
+
+    DspChunk DspRate::ProcessEosChunk(DspRateBackend* soxr, DspChunk& chunk)
+    {
+        assert(soxr);
+
+        DspChunk output;
+
+        if (!chunk.IsEmpty())
+            output = ProcessChunk(soxr, chunk);
+
+        for (;;)
+        {
+            DspChunk tailChunk(DspFormat::Float, m_channels, m_outputRate, m_outputRate);
+
+            size_t outputDo = tailChunk.GetFrameCount();
+            size_t outputDone = soxr->Process(nullptr, 0, (float*)tailChunk.GetData(), outputDo);
+            tailChunk.ShrinkTail(outputDone);
+
+            DspChunk::MergeChunks(output, tailChunk);
+
+            if (outputDone < outputDo)
+                break;
+        }
+
+        return output;
+    }
+
+    DspChunk DspRate::ProcessCounted(DspRateBackend* soxr, DspChunk& chunk)
+    {
+        DspChunk output = ProcessChunk(soxr, chunk);
+
+        if (soxr == m_soxrc.get())
+        {
+            m_constantInputFrames += chunk.GetFrameCount();
+            m_constantOutputFrames += output.GetFrameCount();
+        }
+        else
+        {
+            assert(soxr == m_soxrv.get());
+
+            m_variableInputFrames += chunk.GetFrameCount();
+            m_variableOutputFrames += output.GetFrameCount();
+
+            // soxr_delay() method is not implemented for variable rate conversion yet,
+            // but the delay stays more or less constant and we can calculate it in a roundabout way.
+            if (m_variableDelay == 0 && m_variableOutputFrames > 0)
+            {
+                uint64_t inputPosition = (m_speed == 1.0) ? llMulDiv(m_variableOutputFrames, m_inputRate, m_outputRate, 0) :
+                                                            (uint64_t)(m_variableOutputFrames * m_speed * m_inputRate / m_outputRate);
+                m_variableDelay = m_variableInputFrames - inputPosition;
+            }
+
+            // Output of the handover pre-roll, the old conversion has covered it already.
+            if (m_variableDiscardFrames > 0)
+            {
+                const size_t discardFrames = (size_t)std::min<uint64_t>(m_variableDiscardFrames, output.GetFrameCount());
+                output.ShrinkHead(output.GetFrameCount() - discardFrames);
+                m_variableDiscardFrames -= discardFrames;
+            }
+        }
+
+        return output;
+    }
+
+    void DspRate::Handover(DspChunk& chunk)
+    {
+        assert(m_inStateTransition);
+        assert(m_state == State::Variable);
+        assert(!m_soxrv);
+        assert(!chunk.IsEmpty());
+
+        // Instead of running both resamplers over the same input and cross-fading, the old conversion ends at
+        // input frame N and the variable one starts there. The old one gets some input past N so its output is
+        // complete up to N, the new one starts a bit before N and its output up to N is thrown away.
+        // Both overlaps are processed once, at the handover. N and the overlap are picked on whole output
+        // frame boundaries, so the two output grids line up exactly.
+        uint32_t period = m_inputRate / GreatestCommonDivisor(m_inputRate, m_outputRate);
+
+        // Odd rate pairs, the grids only meet every few hundred milliseconds.
+        // Settle for sub-frame misalignment, it's still far below a cross-fade smear.
+        if (period > m_inputRate / 20)
+            period = 1;
+
+        const size_t frames = chunk.GetFrameCount();
+        const uint64_t before = m_soxrc ? m_constantInputFrames : 0;
+
+        // The constant resampler delay is the length of its filter tail, reuse it for the variable one.
+        size_t overlap = m_soxrc ? (size_t)std::ceil(m_soxrc->GetDelay() * m_inputRate / m_outputRate) : 0;
+        overlap = std::max<size_t>(overlap, m_inputRate / 500); // 2ms
+        overlap = (overlap + period - 1) / period * period;
+
+        const size_t handover = (size_t)(overlap + (period - (before + overlap) % period) % period);
+
+        if (handover + (m_soxrc ? overlap : 0) > frames)
+        {
+            // Not enough frames to hand over cleanly, keep the old conversion for another chunk.
+            if (m_soxrc)
+                chunk = ProcessCounted(m_soxrc.get(), chunk);
+
+            return;
+        }
+
+        DspChunk::ToFloat(chunk);
+
+        DspChunk output;
+
+        if (m_soxrc)
+        {
+            DspChunk head = CopyFrames(chunk, 0, handover + overlap);
+            output = ProcessEosChunk(m_soxrc.get(), head);
+
+            const uint64_t target = llMulDiv(before + handover, m_outputRate, m_inputRate, 0) - m_constantOutputFrames;
+            assert(output.GetFrameCount() >= target);
+
+            if (output.GetFrameCount() > target)
+                output.ShrinkTail((size_t)target);
+
+            m_soxrc = nullptr;
+        }
+        else
+        {
+            output = CopyFrames(chunk, 0, handover);
+        }
+
+        CreateBackend();
+        assert(m_soxrv);
+
+        m_variableDiscardFrames = (uint64_t)overlap * m_outputRate / m_inputRate;
+
+        DspChunk tail = CopyFrames(chunk, handover - overlap, frames - handover + overlap);
+        DspChunk variableOutput = ProcessCounted(m_soxrv.get(), tail);
+        DspChunk::MergeChunks(output, variableOutput);
+
+        m_inStateTransition = false;
+
+        chunk = std::move(output);
+    }
+
+    void DspRate::CreateBackend()
+    {
+        assert(m_state != State::Passthrough);
+        assert(m_inputRate > 0);
+        assert(m_outputRate > 0);
+        assert(m_channels > 0);
+
+        if (m_state == State::Variable)
+        {
+            assert(!m_soxrv);
+
+            m_soxrv = MakeBackend(true);
+            m_variableRatio = m_speed * m_inputRate / m_outputRate;
+
+            // Speed is a plain ratio change, pitch goes along with it.
+            if (m_speed != 1.0)
+                m_soxrv->SetIoRatio(m_variableRatio, 0);
+
+            m_variableInputFrames = 0;
+            m_variableOutputFrames = 0;
+            m_variableDelay = 0;
+            m_variableDiscardFrames = 0;
+        }
+        else if (m_state == State::Constant)
+        {
+            assert(m_inputRate != m_outputRate);
+            assert(!m_soxrc);
+
+            m_soxrc = MakeBackend(false);
+
+            m_constantInputFrames = 0;
+            m_constantOutputFrames = 0;
+        }
+    }
+
+    std::unique_ptr<DspRateBackend> DspRate::MakeBackend(bool variable)
+    {
+        uint32_t groups = 1;
+
+        if (m_multithreaded)
+        {
+            // At least two channels per resampler, splitting further doesn't pay for the synchronization.
+            groups = std::min(std::max(1u, std::thread::hardware_concurrency()), m_channels / 2);
+        }
+
+        try
+        {
+            return std::make_unique<DspRateBackend>(variable, m_inputRate, m_outputRate, m_channels, groups);
+        }
+        catch (std::system_error&)
+        {
+            DebugOut(ClassName(this), "failed to start resampler threads");
+            return std::make_unique<DspRateBackend>(variable, m_inputRate, m_outputRate, m_channels, 1);
+        }
+    }
+
+    DspRateBackend* DspRate::GetBackend()
+    {
+        return (m_state == State::Constant) ? m_soxrc.get() :
+               (m_state == State::Variable) ? m_soxrv.get() : nullptr;
+    }
+
+    void DspRate::DestroyBackends()
+    {
+        m_soxrc = nullptr;
+        m_soxrv = nullptr;
+    }
+}
@@ -1,67 +1,81 @@
-#pragma once
-
-#include "DspBase.h"
-
-#include <soxr.h>
-
-namespace SaneAudioRenderer
-{
-    class DspRate final
-        : public DspBase
-    {
-    public:
-
-        DspRate() = default;
-        DspRate(const DspRate&) = delete;
-        DspRate& operator=(const DspRate&) = delete;
-        ~DspRate();
-
-        void Initialize(bool variable, uint32_t inputRate, uint32_t outputRate, uint32_t channels);
-
-        std::wstring Name() override { return L"Rate"; }
-
-        bool Active() override;
-
-        void Process(DspChunk& chunk) override;
-        void Finish(DspChunk& chunk) override;
-
-        void Adjust(REFERENCE_TIME time);
-
-    private:
-
-        enum class State
-        {
-            Passthrough,
-            Constant,
-            Variable,
-        };
-
-        DspChunk ProcessChunk(soxr_t soxr, DspChunk& chunk);
-        DspChunk ProcessEosChunk(soxr_t soxr, DspChunk& chunk);
-
-        void FinishStateTransition(DspChunk& processedChunk, DspChunk& unprocessedChunk, bool eos);
-
-        void CreateBackend();
-        soxr_t GetBackend();
-        void DestroyBackends();
-
-        soxr_t m_soxrc = nullptr;
-        soxr_t m_soxrv = nullptr;
-
-        State m_state = State::Passthrough;
-
-        bool m_inStateTransition = false;
-        std::pair<bool, size_t> m_transitionCorrelation;
-        std::pair<DspChunk, DspChunk> m_transitionChunks;
-
-        uint32_t m_inputRate = 0;
-        uint32_t m_outputRate = 0;
-        uint32_t m_channels = 0;
-
-        uint64_t m_variableInputFrames = 0;
-        uint64_t m_variableOutputFrames = 0;
-        uint64_t m_variableDelay = 0; // In input samples.
-
-        REFERENCE_TIME m_adjustTime = 0; // Negative time - less samples, positive time - more samples.
-    };
-}
+#pragma once
+
+#include "DspBase.h"
+#include "DspRateBackend.h"
+
+namespace SaneAudioRenderer
+{
+    class DspRate final
+        : public DspBase
+    {
+    public:
+
+        DspRate() = default;
+        DspRate(const DspRate&) = delete;
+        DspRate& operator=(const DspRate&) = delete;
+        ~DspRate();
+
+        void Initialize(bool variable, uint32_t inputRate, uint32_t outputRate, uint32_t channels,
+                        bool multithreaded, double speed);
+
+        bool IsMultithreaded() const { return m_multithreaded; }
+        bool IsVariable() const { return m_state == State::Variable; }
+        double GetSpeed() const { return m_speed; }
+
+        // Speed changes through resampling shift the pitch along, which is only tolerable for small ones.
+        static bool IsSpeedSupported(double speed) { return std::abs(speed - 1.0) <= 0.05; }
+
+        std::wstring Name() override { return L"Rate"; }
+
+        bool Active() override;
+
+        void Process(DspChunk& chunk) override;
+        void Finish(DspChunk& chunk) override;
+
+        void Adjust(REFERENCE_TIME time);
+
+    private:
+
+        enum class State
+        {
+            Passthrough,
+            Constant,
+            Variable,
+        };
+
+        DspChunk ProcessChunk(DspRateBackend* soxr, DspChunk& chunk);
+        DspChunk ProcessEosChunk(DspRateBackend* soxr, DspChunk& chunk);
+
+        DspChunk ProcessCounted(DspRateBackend* soxr, DspChunk& chunk);
+        void Handover(DspChunk& chunk);
+
+        void CreateBackend();
+        std::unique_ptr<DspRateBackend> MakeBackend(bool variable);
+        DspRateBackend* GetBackend();
+        void DestroyBackends();
+
+        std::unique_ptr<DspRateBackend> m_soxrc;
+        std::unique_ptr<DspRateBackend> m_soxrv;
+
+        State m_state = State::Passthrough;
+
+        bool m_inStateTransition = false;
+
+        uint64_t m_constantInputFrames = 0;
+        uint64_t m_constantOutputFrames = 0;
+
+        uint32_t m_inputRate = 0;
+        uint32_t m_outputRate = 0;
+        uint32_t m_channels = 0;
+        bool m_multithreaded = false;
+        double m_speed = 1.0;
+
+        uint64_t m_variableInputFrames = 0;
+        uint64_t m_variableOutputFrames = 0;
+        uint64_t m_variableDelay = 0; // In input samples.
+        double m_variableRatio = 0.0;
+        uint64_t m_variableDiscardFrames = 0;
+
+        REFERENCE_TIME m_adjustTime = 0; // Negative time - less samples, positive time - more samples.
+    };
+}
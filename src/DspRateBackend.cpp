@@ -0,0 +1,200 @@
+#include "pch.h"
+#include "DspRateBackend.h"
+
+namespace SaneAudioRenderer
+{
+    DspRateBackend::DspRateBackend(bool variable, uint32_t inputRate, uint32_t outputRate,
+                                   uint32_t channels, uint32_t groups)
+        : m_channels(channels)
+    {
+        assert(inputRate > 0);
+        assert(outputRate > 0);
+        assert(channels > 0);
+
+        groups = std::max(1u, std::min(groups, channels));
+
+        if (static_cast<HANDLE>(m_done) == NULL)
+            throw std::bad_alloc();
+
+        try
+        {
+            const int priority = GetThreadPriority(GetCurrentThread());
+
+            for (uint32_t i = 0, firstChannel = 0; i < groups; i++)
+            {
+                auto group = std::make_unique<Group>();
+
+                if (static_cast<HANDLE>(group->wake) == NULL)
+                    throw std::bad_alloc();
+
+                group->firstChannel = firstChannel;
+                group->channels = (channels - firstChannel) / (groups - i);
+                firstChannel += group->channels;
+
+                auto ioSpec = soxr_io_spec(SOXR_FLOAT32_I, SOXR_FLOAT32_I);
+
+                if (variable)
+                {
+                    auto qualitySpec = soxr_quality_spec(SOXR_HQ, SOXR_VR);
+                    group->soxr = soxr_create(inputRate * 2, outputRate, group->channels,
+                                              nullptr, &ioSpec, &qualitySpec, nullptr);
+
+                    if (group->soxr)
+                        soxr_set_io_ratio(group->soxr, (double)inputRate / outputRate, 0);
+                }
+                else
+                {
+                    auto qualitySpec = soxr_quality_spec(SOXR_HQ, 0);
+                    group->soxr = soxr_create(inputRate, outputRate, group->channels,
+                                              nullptr, &ioSpec, &qualitySpec, nullptr);
+                }
+
+                if (!group->soxr)
+                    throw std::bad_alloc();
+
+                m_groups.emplace_back(std::move(group));
+
+                if (i > 0)
+                {
+                    Group& g = *m_groups.back();
+                    g.thread = std::thread(std::bind(&DspRateBackend::WorkerFeed, this, std::ref(g), priority));
+                }
+            }
+        }
+        catch (...)
+        {
+            StopWorkers();
+            throw;
+        }
+
+        if (groups > 1)
+            DebugOut(ClassName(this), "splitting", channels, "channels between", groups, "resamplers");
+    }
+
+    DspRateBackend::~DspRateBackend()
+    {
+        StopWorkers();
+    }
+
+    size_t DspRateBackend::Process(const float* pInput, size_t inputFrames, float* pOutput, size_t outputFrames)
+    {
+        assert(!m_groups.empty());
+
+        if (m_groups.size() == 1)
+        {
+            // Single instance covers all channels, no need to deinterleave.
+            size_t outputDone = 0;
+            soxr_process(m_groups[0]->soxr, pInput, inputFrames, nullptr, pOutput, outputFrames, &outputDone);
+            return outputDone;
+        }
+
+        // Allocate on the caller thread, workers must not throw.
+        for (auto& group : m_groups)
+        {
+            if (pInput && group->input.size() < std::max<size_t>(1, inputFrames * group->channels))
+                group->input.resize(std::max<size_t>(1, inputFrames * group->channels));
+
+            if (group->output.size() < outputFrames * group->channels)
+                group->output.resize(outputFrames * group->channels);
+        }
+
+        m_jobInput = pInput;
+        m_jobInputFrames = inputFrames;
+        m_jobOutput = pOutput;
+        m_jobOutputFrames = outputFrames;
+
+        m_pending = (uint32_t)m_groups.size() - 1;
+
+        for (size_t i = 1; i < m_groups.size(); i++)
+            m_groups[i]->wake.Set();
+
+        ProcessGroup(*m_groups[0]);
+
+        m_done.Wait();
+
+        size_t outputDone = m_groups[0]->outputDone;
+
+        for (auto& group : m_groups)
+        {
+            // Identical filters on identical input produce identical frame counts.
+            assert(group->outputDone == outputDone);
+            outputDone = std::min(outputDone, group->outputDone);
+        }
+
+        return outputDone;
+    }
+
+    void DspRateBackend::SetIoRatio(double ratio, size_t slewLength)
+    {
+        for (auto& group : m_groups)
+            soxr_set_io_ratio(group->soxr, ratio, slewLength);
+    }
+
+    double DspRateBackend::GetDelay() const
+    {
+        assert(!m_groups.empty());
+        return soxr_delay(m_groups[0]->soxr);
+    }
+
+    void DspRateBackend::ProcessGroup(Group& group)
+    {
+        const uint32_t channels = group.channels;
+
+        if (m_jobInput)
+        {
+            for (size_t frame = 0; frame < m_jobInputFrames; frame++)
+            {
+                const float* pFrame = m_jobInput + frame * m_channels + group.firstChannel;
+
+                for (uint32_t channel = 0; channel < channels; channel++)
+                    group.input[frame * channels + channel] = pFrame[channel];
+            }
+        }
+
+        group.outputDone = 0;
+        soxr_process(group.soxr, m_jobInput ? group.input.data() : nullptr, m_jobInputFrames, nullptr,
+                                 group.output.data(), m_jobOutputFrames, &group.outputDone);
+
+        for (size_t frame = 0; frame < group.outputDone; frame++)
+        {
+            float* pFrame = m_jobOutput + frame * m_channels + group.firstChannel;
+
+            for (uint32_t channel = 0; channel < channels; channel++)
+                pFrame[channel] = group.output[frame * channels + channel];
+        }
+    }
+
+    void DspRateBackend::WorkerFeed(Group& group, int priority)
+    {
+        SetThreadPriority(GetCurrentThread(), priority);
+
+        for (;;)
+        {
+            group.wake.Wait();
+
+            if (m_exit)
+                break;
+
+            ProcessGroup(group);
+
+            if (--m_pending == 0)
+                m_done.Set();
+        }
+    }
+
+    void DspRateBackend::StopWorkers()
+    {
+        m_exit = true;
+
+        for (auto& group : m_groups)
+        {
+            if (group->thread.joinable())
+            {
+                group->wake.Set();
+                group->thread.join();
+            }
+        }
+
+        m_groups.clear();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <soxr.h>
+
+namespace SaneAudioRenderer
+{
+    // Interleaved float soxr wrapper that can split channels between several soxr instances.
+    // Each channel group runs on its own worker thread (the first one on the caller thread),
+    // output is written back to the group's own channel slots, so the result is independent of scheduling.
+    class DspRateBackend final
+    {
+    public:
+
+        DspRateBackend(bool variable, uint32_t inputRate, uint32_t outputRate, uint32_t channels, uint32_t groups);
+        DspRateBackend(const DspRateBackend&) = delete;
+        DspRateBackend& operator=(const DspRateBackend&) = delete;
+        ~DspRateBackend();
+
+        // Takes all input (nullptr to flush) and returns up to outputFrames of output,
+        // the rest stays buffered in soxr until the next call.
+        size_t Process(const float* pInput, size_t inputFrames, float* pOutput, size_t outputFrames);
+
+        void SetIoRatio(double ratio, size_t slewLength);
+
+        double GetDelay() const;
+
+        uint32_t GetGroupCount() const { return (uint32_t)m_groups.size(); }
+
+    private:
+
+        struct Group final
+        {
+            ~Group() { if (soxr) soxr_delete(soxr); }
+
+            soxr_t soxr = nullptr;
+
+            uint32_t firstChannel = 0;
+            uint32_t channels = 0;
+
+            std::vector<float> input;
+            std::vector<float> output;
+            size_t outputDone = 0;
+
+            CAMEvent wake;
+            std::thread thread;
+        };
+
+        void ProcessGroup(Group& group);
+
+        void WorkerFeed(Group& group, int priority);
+
+        void StopWorkers();
+
+        const uint32_t m_channels;
+
+        std::vector<std::unique_ptr<Group>> m_groups;
+
+        CAMEvent m_done;
+        std::atomic<uint32_t> m_pending = 0;
+        std::atomic<bool> m_exit = false;
+
+        const float* m_jobInput = nullptr;
+        size_t m_jobInputFrames = 0;
+        float* m_jobOutput = nullptr;
+        size_t m_jobOutputFrames = 0;
+    };
+}
@@ -0,0 +1,338 @@
+#include "pch.h"
+#include "GlitchDetector.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        // A block is suspicious when its sharpest corner stands this far above the usual curvature,
+        const float CurvatureRatio = 8.0f;
+        // is audible at all (-40dBFS),
+        const float CurvatureFloor = 0.01f;
+        // and stands out in the block itself too. A louder passage lifts the whole block, a glitch only a sample or two.
+        const float SpikeRatio = 8.0f;
+
+        const REFERENCE_TIME MinSilence = OneMillisecond;
+        const REFERENCE_TIME MaxSilence = OneSecond;
+
+        // How far back a correction may lie and still be the cause, covers the latency of the processors.
+        const REFERENCE_TIME CauseWindow = 200 * OneMillisecond;
+
+        struct BlockStats
+        {
+            float maxCurvature;
+            float sumCurvature;
+            bool nonSilent;
+        };
+
+        // Curvature (second difference) of every sample against the same channel in the two previous frames.
+        // Works straight on interleaved data, so any channel count vectorizes.
+        BlockStats GetBlockStats(const float* data, size_t samples, uint32_t channels)
+        {
+            const __m128 signMask = _mm_set1_ps(-0.0f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 two = _mm_set1_ps(2.0f);
+
+            __m128 maxCurvature = zero;
+            __m128 sumCurvature = zero;
+            __m128 nonSilent = zero;
+
+            const float* prev1 = data - channels;
+            const float* prev2 = data - 2 * channels;
+
+            size_t i = 0;
+
+            for (; i + 4 <= samples; i += 4)
+            {
+                const __m128 x = _mm_loadu_ps(data + i);
+                const __m128 c = _mm_andnot_ps(signMask, _mm_add_ps(_mm_sub_ps(x, _mm_mul_ps(two, _mm_loadu_ps(prev1 + i))),
+                                                                    _mm_loadu_ps(prev2 + i)));
+                maxCurvature = _mm_max_ps(maxCurvature, c);
+                sumCurvature = _mm_add_ps(sumCurvature, c);
+                nonSilent = _mm_or_ps(nonSilent, _mm_cmpneq_ps(x, zero));
+            }
+
+            float max[4], sum[4];
+            _mm_storeu_ps(max, maxCurvature);
+            _mm_storeu_ps(sum, sumCurvature);
+
+            BlockStats stats = {std::max(std::max(max[0], max[1]), std::max(max[2], max[3])),
+                                sum[0] + sum[1] + sum[2] + sum[3],
+                                _mm_movemask_ps(nonSilent) != 0};
+
+            for (; i < samples; i++)
+            {
+                const float c = std::abs(data[i] - 2.0f * prev1[i] + prev2[i]);
+                stats.maxCurvature = std::max(stats.maxCurvature, c);
+                stats.sumCurvature += c;
+                stats.nonSilent |= (data[i] != 0.0f);
+            }
+
+            return stats;
+        }
+    }
+
+    GlitchDetector::~GlitchDetector()
+    {
+        DumpStatistics();
+    }
+
+    void GlitchDetector::Initialize(bool enable, uint32_t rate, uint32_t channels)
+    {
+        DumpStatistics();
+
+        // Disabled detector keeps no channels, everything else returns early on that.
+        m_rate = rate;
+        m_channels = enable ? channels : 0;
+
+        m_log = {};
+        m_logCount = 0;
+
+        m_glitches = {};
+        m_totalFrames = 0;
+
+        Reset();
+    }
+
+    void GlitchDetector::Reset()
+    {
+        m_buffer.assign(2 * m_channels, 0.0f);
+
+        m_position = 0;
+        m_analyzedBlocks = 0;
+        m_averageCurvature = 0.0f;
+
+        m_signal = false;
+        m_inSilence = false;
+        m_silenceStart = 0;
+
+        // Old entries point into the previous stream.
+        m_logCount = 0;
+    }
+
+    void GlitchDetector::NoteCorrection(Event correction)
+    {
+        assert(correction > Event::Silence && correction < Event::Count);
+
+        if (m_channels == 0)
+            return;
+
+        Log({correction, Event::Unknown, m_position, 0});
+    }
+
+    void GlitchDetector::Analyze(DspChunk& chunk)
+    {
+        if (m_channels == 0 || chunk.IsEmpty() || chunk.GetFormat() == DspFormat::Unknown)
+            return;
+
+        if (chunk.GetChannelCount() != m_channels || chunk.GetRate() != m_rate)
+        {
+            assert(false);
+            return;
+        }
+
+        const size_t frames = chunk.GetFrameCount();
+        const size_t history = 2 * m_channels;
+
+        // The buffer only grows, steady state streaming doesn't allocate.
+        if (m_buffer.size() < history + frames * m_channels)
+            m_buffer.resize(history + frames * m_channels);
+
+        DspChunk::ToBuffer(DspFormat::Float, chunk, frames, reinterpret_cast<char*>(m_buffer.data() + history));
+
+        for (size_t frame = 0; frame < frames; frame += BlockFrames)
+            AnalyzeBlock(m_buffer.data() + history + frame * m_channels, std::min<size_t>(BlockFrames, frames - frame));
+
+        std::copy_n(m_buffer.data() + frames * m_channels, history, m_buffer.data());
+
+        m_totalFrames += frames;
+    }
+
+    GlitchDetector::Status GlitchDetector::GetStatus() const
+    {
+        Status status;
+        status.enabled = IsEnabled();
+        status.rate = m_rate;
+        status.analyzedFrames = m_totalFrames;
+        status.glitches = m_glitches;
+
+        const size_t count = std::min<size_t>(m_logCount, LogSize);
+        status.log.reserve(count);
+
+        for (size_t i = m_logCount - count; i < m_logCount; i++)
+            status.log.push_back(m_log[i % LogSize]);
+
+        return status;
+    }
+
+    const char* GlitchDetector::GetEventName(Event event)
+    {
+        switch (event)
+        {
+            case Event::Discontinuity:    return "discontinuity";
+            case Event::Silence:          return "silence";
+            case Event::RatePad:          return "rate pad";
+            case Event::RateDrop:         return "rate drop";
+            case Event::SampleCorrection: return "sample correction";
+            case Event::RateTransition:   return "rate transition";
+            case Event::DeviceRenew:      return "device renew";
+        }
+
+        return "unknown";
+    }
+
+    void GlitchDetector::AnalyzeBlock(const float* data, size_t frames)
+    {
+        const BlockStats stats = GetBlockStats(data, frames * m_channels, m_channels);
+
+        bool boundary = false;
+
+        if (!stats.nonSilent)
+        {
+            if (!m_inSilence)
+            {
+                m_inSilence = true;
+                m_silenceStart = m_position;
+                boundary = true;
+            }
+        }
+        else
+        {
+            // Silence edges are found exactly, scanning stops at the first frame with signal.
+            size_t leading = 0;
+            while (m_inSilence && IsSilentFrame(data + leading * m_channels))
+                leading++;
+
+            if (m_inSilence)
+            {
+                EndSilence(m_position + leading);
+                boundary = true;
+            }
+
+            size_t trailing = 0;
+            while (IsSilentFrame(data + (frames - 1 - trailing) * m_channels))
+                trailing++;
+
+            m_signal = true;
+
+            if (trailing > 0)
+            {
+                m_inSilence = true;
+                m_silenceStart = m_position + frames - trailing;
+                boundary = true;
+            }
+        }
+
+        const float average = stats.sumCurvature / (frames * m_channels);
+        const float threshold = std::max(m_averageCurvature * CurvatureRatio, CurvatureFloor);
+
+        // Steps into and out of silence are already accounted for.
+        if (!boundary && m_analyzedBlocks >= WarmUpBlocks &&
+            stats.maxCurvature > threshold && stats.maxCurvature > average * SpikeRatio)
+        {
+            size_t frame = 0;
+
+            for (; frame < frames - 1; frame++)
+            {
+                const float* x = data + frame * m_channels;
+                const float* prev1 = x - m_channels;
+                const float* prev2 = x - 2 * m_channels;
+
+                bool found = false;
+                for (uint32_t channel = 0; channel < m_channels; channel++)
+                    found |= std::abs(x[channel] - 2.0f * prev1[channel] + prev2[channel]) > threshold;
+
+                if (found)
+                    break;
+            }
+
+            Report(Event::Discontinuity, m_position + frame, 0);
+        }
+
+        // Silence would leave nothing to compare the signal against once it's back.
+        if (stats.nonSilent)
+        {
+            m_averageCurvature = (m_analyzedBlocks == 0) ? average :
+                                                           m_averageCurvature + (average - m_averageCurvature) * (1.0f / 32);
+            m_analyzedBlocks++;
+        }
+
+        m_position += frames;
+    }
+
+    bool GlitchDetector::IsSilentFrame(const float* frame) const
+    {
+        for (uint32_t channel = 0; channel < m_channels; channel++)
+        {
+            if (frame[channel] != 0.0f)
+                return false;
+        }
+
+        return true;
+    }
+
+    void GlitchDetector::EndSilence(uint64_t frame)
+    {
+        assert(m_inSilence);
+        assert(frame >= m_silenceStart);
+
+        m_inSilence = false;
+
+        const uint64_t frames = frame - m_silenceStart;
+
+        // Only a gap inside the signal is a glitch, digital silence between tracks is left alone.
+        if (m_signal &&
+            frames >= (uint64_t)TimeToFrames(MinSilence, m_rate) &&
+            frames < (uint64_t)TimeToFrames(MaxSilence, m_rate))
+        {
+            Report(Event::Silence, m_silenceStart, frames);
+        }
+    }
+
+    void GlitchDetector::Report(Event glitch, uint64_t frame, uint64_t frames)
+    {
+        const uint64_t window = TimeToFrames(CauseWindow, m_rate);
+
+        Event cause = Event::Unknown;
+
+        // Most recent correction wins.
+        for (size_t i = 0; i < std::min<size_t>(m_logCount, LogSize); i++)
+        {
+            const Entry& entry = m_log[(m_logCount - 1 - i) % LogSize];
+
+            if (entry.event > Event::Silence && entry.frame <= frame + BlockFrames && entry.frame + window >= frame)
+            {
+                cause = entry.event;
+                break;
+            }
+        }
+
+        m_glitches[(size_t)cause]++;
+
+        Log({glitch, cause, frame, frames});
+
+        DebugOut(ClassName(this), GetEventName(glitch), "at", frame, "frames", FramesToTimeLong(frame, m_rate) / 10000.,
+                 "ms, lasting", frames, "frames, caused by", GetEventName(cause));
+    }
+
+    void GlitchDetector::Log(const Entry& entry)
+    {
+        m_log[m_logCount % LogSize] = entry;
+        m_logCount++;
+    }
+
+    void GlitchDetector::DumpStatistics()
+    {
+        if (m_totalFrames == 0)
+            return;
+
+        for (size_t i = 0; i < m_glitches.size(); i++)
+        {
+            if (m_glitches[i] > 0)
+            {
+                DebugOut(ClassName(this), m_glitches[i], "glitches caused by", GetEventName((Event)i), "in",
+                         FramesToTimeLong(m_totalFrames, m_rate) / OneSecond, "seconds");
+            }
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    // Watches the final stream for audible discontinuities and inserted silences, and blames each of them
+    // on the nearest preceding correction the renderer made (kept in a small ring log).
+    // Off unless enabled in settings, it converts and scans every chunk that goes out.
+    class GlitchDetector final
+    {
+    public:
+
+        enum class Event
+        {
+            Unknown,
+            // Glitches, found on the output.
+            Discontinuity,
+            Silence,
+            // Corrections, reported by the renderer.
+            RatePad,
+            RateDrop,
+            SampleCorrection,
+            RateTransition,
+            DeviceRenew,
+            Count,
+        };
+
+        struct Entry
+        {
+            Event event;
+            Event cause; // Glitches only, the correction blamed for it.
+            uint64_t frame;
+            uint64_t frames;
+        };
+
+        struct Status
+        {
+            bool enabled = false;
+            uint32_t rate = 0;
+            uint64_t analyzedFrames = 0;
+            std::array<uint64_t, (size_t)Event::Count> glitches = {}; // indexed by cause
+            std::vector<Entry> log; // oldest first
+        };
+
+        GlitchDetector() = default;
+        GlitchDetector(const GlitchDetector&) = delete;
+        GlitchDetector& operator=(const GlitchDetector&) = delete;
+        ~GlitchDetector();
+
+        void Initialize(bool enable, uint32_t rate, uint32_t channels);
+        bool IsEnabled() const { return m_channels != 0; }
+
+        // Starts over at the beginning of the analyzed stream, keeping the statistics.
+        void Reset();
+
+        // Corrections are stamped with the position of the next analyzed frame.
+        void NoteCorrection(Event correction);
+
+        void Analyze(DspChunk& chunk);
+
+        Status GetStatus() const;
+
+        static const char* GetEventName(Event event);
+
+    private:
+
+        enum
+        {
+            BlockFrames = 64,
+            WarmUpBlocks = 16,
+            LogSize = 64,
+        };
+
+        void AnalyzeBlock(const float* data, size_t frames);
+        bool IsSilentFrame(const float* frame) const;
+
+        void EndSilence(uint64_t frame);
+        void Report(Event glitch, uint64_t frame, uint64_t frames);
+
+        void Log(const Entry& entry);
+        void DumpStatistics();
+
+        uint32_t m_rate = 0;
+        uint32_t m_channels = 0;
+
+        std::vector<float> m_buffer; // Two frames of history followed by the chunk converted to float.
+
+        uint64_t m_position = 0;
+        uint64_t m_analyzedBlocks = 0;
+        float m_averageCurvature = 0.0f;
+
+        bool m_signal = false;
+        bool m_inSilence = false;
+        uint64_t m_silenceStart = 0;
+
+        std::array<Entry, LogSize> m_log = {};
+        size_t m_logCount = 0;
+
+        std::array<uint64_t, (size_t)Event::Count> m_glitches = {};
+        uint64_t m_totalFrames = 0;
+    };
+}
@@ -0,0 +1,94 @@
+#include "pch.h"
+#include "LockProfiler.h"
+
+#ifdef SANEAR_LOCK_PROFILER
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        std::atomic<LockProfilerSite*> g_sites = nullptr;
+
+        int64_t CounterToMicroseconds(int64_t counter)
+        {
+            static const int64_t frequency = GetPerformanceFrequency();
+            return llMulDiv(counter, 1000000, frequency, 0);
+        }
+
+        void UpdateMax(std::atomic<int64_t>& max, int64_t value)
+        {
+            int64_t current = max;
+            while (value > current && !max.compare_exchange_weak(current, value));
+        }
+    }
+
+    LockProfilerSite::LockProfilerSite(const char* function, int line)
+        : m_function(function)
+        , m_line(line)
+    {
+        m_next = g_sites;
+        while (!g_sites.compare_exchange_weak(m_next, this));
+    }
+
+    void LockProfilerSite::Record(int64_t waitCounter, int64_t holdCounter)
+    {
+        const int64_t wait = CounterToMicroseconds(waitCounter);
+        const int64_t hold = CounterToMicroseconds(holdCounter);
+
+        m_count++;
+
+        m_waitTotal += wait;
+        UpdateMax(m_waitMax, wait);
+        AddToHistogram(m_waitHistogram, wait);
+
+        m_holdTotal += hold;
+        UpdateMax(m_holdMax, hold);
+        AddToHistogram(m_holdHistogram, hold);
+    }
+
+    void LockProfilerSite::DumpAll()
+    {
+        // Goes out even in release builds, that's where the spikes are.
+        for (LockProfilerSite* pSite = g_sites; pSite; pSite = pSite->m_next)
+        {
+            const uint64_t count = pSite->m_count;
+
+            if (count == 0)
+                continue;
+
+            DebugOutBody("lock", pSite->m_function, pSite->m_line, "count", count,
+                         "wait avg", pSite->m_waitTotal.load() / (double)count, "max", pSite->m_waitMax.load(),
+                         "hold avg", pSite->m_holdTotal.load() / (double)count, "max", pSite->m_holdMax.load(), "(us)");
+
+            DebugOutBody("lock", pSite->m_function, pSite->m_line,
+                         "wait", FormatHistogram(pSite->m_waitHistogram).c_str(),
+                         "hold", FormatHistogram(pSite->m_holdHistogram).c_str());
+        }
+    }
+
+    void LockProfilerSite::AddToHistogram(Histogram& histogram, int64_t microseconds)
+    {
+        size_t bucket = 0;
+
+        while (microseconds > 0 && bucket < Buckets - 1)
+        {
+            microseconds >>= 1;
+            bucket++;
+        }
+
+        histogram[bucket]++;
+    }
+
+    std::string LockProfilerSite::FormatHistogram(const Histogram& histogram)
+    {
+        // Bucket n holds times below 2^n microseconds.
+        std::ostringstream stream;
+
+        for (size_t i = 0; i < Buckets; i++)
+            stream << (i > 0 ? "/" : "") << histogram[i];
+
+        return stream.str();
+    }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+#ifdef SANEAR_LOCK_PROFILER
+
+    // Acquisition statistics of a single ProfiledLock() call site. Sites are static, live
+    // for the whole process and are never unregistered.
+    class LockProfilerSite final
+    {
+    public:
+
+        LockProfilerSite(const char* function, int line);
+        LockProfilerSite(const LockProfilerSite&) = delete;
+        LockProfilerSite& operator=(const LockProfilerSite&) = delete;
+
+        void Record(int64_t waitCounter, int64_t holdCounter);
+
+        static void DumpAll();
+
+    private:
+
+        enum { Buckets = 16 }; // Powers of two in microseconds, the last one is open-ended.
+
+        using Histogram = std::array<std::atomic<uint32_t>, Buckets>;
+
+        static void AddToHistogram(Histogram& histogram, int64_t microseconds);
+        static std::string FormatHistogram(const Histogram& histogram);
+
+        const char* const m_function;
+        const int m_line;
+
+        std::atomic<uint64_t> m_count = 0;
+        std::atomic<int64_t> m_waitTotal = 0;
+        std::atomic<int64_t> m_waitMax = 0;
+        std::atomic<int64_t> m_holdTotal = 0;
+        std::atomic<int64_t> m_holdMax = 0;
+        Histogram m_waitHistogram = {};
+        Histogram m_holdHistogram = {};
+
+        LockProfilerSite* m_next = nullptr;
+    };
+
+    class ProfiledAutoLock final
+    {
+    public:
+
+        ProfiledAutoLock(CCritSec* pLock, LockProfilerSite& site)
+            : m_lock(pLock)
+            , m_site(site)
+        {
+            const int64_t start = GetPerformanceCounter();
+            m_lock->Lock();
+            m_lockedAt = GetPerformanceCounter();
+            m_wait = m_lockedAt - start;
+        }
+
+        ProfiledAutoLock(const ProfiledAutoLock&) = delete;
+        ProfiledAutoLock& operator=(const ProfiledAutoLock&) = delete;
+
+        ~ProfiledAutoLock()
+        {
+            const int64_t hold = GetPerformanceCounter() - m_lockedAt;
+            m_lock->Unlock();
+            m_site.Record(m_wait, hold);
+        }
+
+    private:
+
+        CCritSec* const m_lock;
+        LockProfilerSite& m_site;
+        int64_t m_lockedAt;
+        int64_t m_wait;
+    };
+
+#   define ProfiledLock(name, pLock) static LockProfilerSite name##Site(__FUNCTION__, __LINE__); \
+                                     ProfiledAutoLock name(pLock, name##Site)
+#else
+#   define ProfiledLock(name, pLock) CAutoLock name(pLock)
+#endif
+}
@@ -0,0 +1,99 @@
+#include "pch.h"
+#include "OfflineRenderer.h"
+
+namespace SaneAudioRenderer
+{
+    OfflineRenderer::OfflineRenderer(ISettings* pSettings, const WAVEFORMATEX& inputFormat,
+                                     const WAVEFORMATEX& outputFormat, double rate, uint32_t ditherSeed)
+        : m_inputFormat(CopyWaveFormat(inputFormat))
+        , m_inputDspFormat(DspFormatFromWaveFormat(inputFormat))
+        , m_outputDspFormat(DspFormatFromWaveFormat(outputFormat))
+        , m_inputRate(inputFormat.nSamplesPerSec)
+    {
+        if (!pSettings ||
+            m_inputDspFormat == DspFormat::Unknown ||
+            m_outputDspFormat == DspFormat::Unknown ||
+            rate <= 0.0)
+        {
+            throw E_INVALIDARG;
+        }
+
+        const auto inChannels = inputFormat.nChannels;
+        const auto inMask = DspMatrix::GetChannelMask(inputFormat);
+        const auto outRate = outputFormat.nSamplesPerSec;
+        const auto outChannels = outputFormat.nChannels;
+        const auto outMask = DspMatrix::GetChannelMask(outputFormat);
+
+        // Mirrors AudioRenderer::InitializeProcessors() for a non-live stream on its own clock.
+        UINT32 timestretchMethod;
+        pSettings->GetTimestretchSettings(&timestretchMethod);
+        const bool resampleSpeed = (timestretchMethod == ISettings::TIMESTRETCH_METHOD_RESAMPLE &&
+                                    DspRate::IsSpeedSupported(rate));
+        const double tempo = resampleSpeed ? 1.0 : rate;
+    #ifdef SANEAR_GPL_PHASE_VOCODER
+        const bool usePhaseVocoder = (timestretchMethod == ISettings::TIMESTRETCH_METHOD_PHASE_VOCODER);
+    #endif
+
+        m_upmixLast = (inChannels < outChannels);
+        const uint32_t rateChannels = m_upmixLast ? inChannels : outChannels;
+
+        m_dspMatrix.Initialize(pSettings, inChannels, inMask, outChannels, outMask);
+        m_dspRate.Initialize(false, m_inputRate, outRate, rateChannels, !!pSettings->GetMultithreadedResampling(),
+                             resampleSpeed ? rate : 1.0);
+    #ifdef SANEAR_GPL_PHASE_VOCODER
+        m_dspTempo1.Initialize(usePhaseVocoder ? 1.0 : tempo, outRate, rateChannels);
+        m_dspTempo2.Initialize(usePhaseVocoder ? tempo : 1.0, outRate, rateChannels);
+    #else
+        m_dspTempo.Initialize(tempo, outRate, rateChannels);
+    #endif
+        m_dspCrossfeed.Initialize(pSettings, outRate, outChannels, outMask);
+        m_dspCompressor.Initialize(pSettings, outRate, outChannels);
+        m_dspLimiter.Initialize(outRate, outChannels, true);
+        m_dspDither.Initialize(m_outputDspFormat, ditherSeed);
+    }
+
+    void OfflineRenderer::Process(const char* pData, size_t frames, std::vector<char>& output)
+    {
+        if (frames == 0)
+            return;
+
+        assert(pData);
+
+        DspChunk chunk(m_inputDspFormat, m_inputFormat->nChannels, frames, m_inputRate);
+        memcpy(chunk.GetData(), pData, chunk.GetSize());
+
+        auto f = [&](DspBase* pDsp)
+        {
+            pDsp->Process(chunk);
+        };
+
+        EnumerateProcessors(f);
+
+        Append(chunk, output);
+    }
+
+    void OfflineRenderer::Finish(std::vector<char>& output)
+    {
+        DspChunk chunk;
+
+        auto f = [&](DspBase* pDsp)
+        {
+            pDsp->Finish(chunk);
+        };
+
+        EnumerateProcessors(f);
+
+        Append(chunk, output);
+    }
+
+    void OfflineRenderer::Append(DspChunk& chunk, std::vector<char>& output)
+    {
+        if (chunk.IsEmpty())
+            return;
+
+        const size_t offset = output.size();
+        output.resize(offset + chunk.GetFrameCount() * chunk.GetChannelCount() * DspFormatSize(m_outputDspFormat));
+
+        DspChunk::ToBuffer(m_outputDspFormat, chunk, chunk.GetFrameCount(), output.data() + offset);
+    }
+}
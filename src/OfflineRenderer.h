@@ -0,0 +1,75 @@
+#pragma once
+
+#include "DspCompressor.h"
+#include "DspCrossfeed.h"
+#include "DspDither.h"
+#include "DspLimiter.h"
+#include "DspMatrix.h"
+#include "DspRate.h"
+#include "DspTempo.h"
+#include "DspTempo2.h"
+#include "Interfaces.h"
+
+namespace SaneAudioRenderer
+{
+    // Runs the renderer's dsp chain over memory buffers as fast as the cpu allows. The output matches
+    // what an exclusive mode device in outputFormat would get at unity volume and centered balance.
+    // Instances share nothing but the chunk pool, so separate streams can be processed on separate threads.
+    class OfflineRenderer final
+    {
+    public:
+
+        OfflineRenderer(ISettings* pSettings, const WAVEFORMATEX& inputFormat, const WAVEFORMATEX& outputFormat,
+                        double rate = 1.0, uint32_t ditherSeed = 0);
+        OfflineRenderer(const OfflineRenderer&) = delete;
+        OfflineRenderer& operator=(const OfflineRenderer&) = delete;
+
+        // Takes interleaved inputFormat frames, appends interleaved outputFormat frames to output.
+        void Process(const char* pData, size_t frames, std::vector<char>& output);
+        void Finish(std::vector<char>& output);
+
+    private:
+
+        template <typename F>
+        void EnumerateProcessors(F f)
+        {
+            // Same order as AudioRenderer::EnumerateProcessors(), minus the player controlled processors.
+            if (!m_upmixLast)
+                f(&m_dspMatrix);
+            f(&m_dspRate);
+        #ifdef SANEAR_GPL_PHASE_VOCODER
+            f(&m_dspTempo1);
+            f(&m_dspTempo2);
+        #else
+            f(&m_dspTempo);
+        #endif
+            if (m_upmixLast)
+                f(&m_dspMatrix);
+            f(&m_dspCrossfeed);
+            f(&m_dspCompressor);
+            f(&m_dspLimiter);
+            f(&m_dspDither);
+        }
+
+        void Append(DspChunk& chunk, std::vector<char>& output);
+
+        SharedWaveFormat m_inputFormat;
+        DspFormat m_inputDspFormat;
+        DspFormat m_outputDspFormat;
+        uint32_t m_inputRate;
+
+        bool m_upmixLast = false;
+        DspMatrix m_dspMatrix;
+        DspRate m_dspRate;
+    #ifdef SANEAR_GPL_PHASE_VOCODER
+        DspTempo m_dspTempo1;
+        DspTempo2 m_dspTempo2;
+    #else
+        DspTempo m_dspTempo;
+    #endif
+        DspCrossfeed m_dspCrossfeed;
+        DspCompressor m_dspCompressor;
+        DspLimiter m_dspLimiter;
+        DspDither m_dspDither;
+    };
+}
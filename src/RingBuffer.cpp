@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "RingBuffer.h"
+
+namespace SaneAudioRenderer
+{
+    void RingBuffer::Allocate(size_t frames, uint32_t frameSize)
+    {
+        assert(frames > 0);
+        assert(frameSize > 0);
+
+        m_data.reset((char*)_aligned_malloc(frames * frameSize, 16));
+
+        if (!m_data.get())
+            throw std::bad_alloc();
+
+        m_frameSize = frameSize;
+        m_capacity = frames;
+
+        Clear();
+    }
+
+    size_t RingBuffer::Write(DspChunk& chunk, DspFormat format)
+    {
+        // Converts straight into the ring and drops the written frames from the chunk.
+        const size_t frames = std::min(chunk.GetFrameCount(), GetFreeCount());
+
+        const size_t tail = (m_head + m_frames) % m_capacity;
+        const size_t firstFrames = std::min(frames, m_capacity - tail);
+
+        DspChunk::ToBuffer(format, chunk, firstFrames, FrameAt(tail));
+        chunk.ShrinkHead(chunk.GetFrameCount() - firstFrames);
+
+        DspChunk::ToBuffer(format, chunk, frames - firstFrames, FrameAt(0));
+        chunk.ShrinkHead(chunk.GetFrameCount() - (frames - firstFrames));
+
+        m_frames += frames;
+
+        return frames;
+    }
+
+    size_t RingBuffer::Read(char* pOutput, size_t frames)
+    {
+        assert(pOutput || frames == 0);
+
+        frames = std::min(frames, m_frames);
+
+        const size_t firstFrames = std::min(frames, m_capacity - m_head);
+
+        memcpy(pOutput, FrameAt(m_head), firstFrames * m_frameSize);
+        memcpy(pOutput + firstFrames * m_frameSize, FrameAt(0), (frames - firstFrames) * m_frameSize);
+
+        m_head = (m_head + frames) % m_capacity;
+        m_frames -= frames;
+
+        // Restart from the beginning once drained, so period sized reads line up with the capacity again.
+        if (m_frames == 0)
+            m_head = 0;
+
+        return frames;
+    }
+
+    size_t RingBuffer::WriteSilence(size_t frames)
+    {
+        frames = std::min(frames, GetFreeCount());
+
+        const size_t tail = (m_head + m_frames) % m_capacity;
+        const size_t firstFrames = std::min(frames, m_capacity - tail);
+
+        ZeroMemory(FrameAt(tail), firstFrames * m_frameSize);
+        ZeroMemory(FrameAt(0), (frames - firstFrames) * m_frameSize);
+
+        m_frames += frames;
+
+        return frames;
+    }
+
+    size_t RingBuffer::PrependSilence(size_t frames)
+    {
+        frames = std::min(frames, GetFreeCount());
+
+        const size_t firstFrames = std::min(frames, m_head);
+
+        ZeroMemory(FrameAt(m_head - firstFrames), firstFrames * m_frameSize);
+        ZeroMemory(FrameAt(m_capacity - (frames - firstFrames)), (frames - firstFrames) * m_frameSize);
+
+        m_head = (m_head + m_capacity - frames) % m_capacity;
+        m_frames += frames;
+
+        return frames;
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "DspChunk.h"
+#include "DspFormat.h"
+
+namespace SaneAudioRenderer
+{
+    class RingBuffer final
+    {
+    public:
+
+        RingBuffer() = default;
+        RingBuffer(const RingBuffer&) = delete;
+        RingBuffer& operator=(const RingBuffer&) = delete;
+
+        void Allocate(size_t frames, uint32_t frameSize);
+
+        bool IsEmpty()           const { return m_frames == 0; }
+
+        uint32_t GetFrameSize()  const { return m_frameSize; }
+        size_t GetCapacity()     const { return m_capacity; }
+        size_t GetFrameCount()   const { return m_frames; }
+        size_t GetFreeCount()    const { return m_capacity - m_frames; }
+
+        size_t Write(DspChunk& chunk, DspFormat format);
+        size_t Read(char* pOutput, size_t frames);
+
+        size_t WriteSilence(size_t frames);
+        size_t PrependSilence(size_t frames);
+
+        void Clear() { m_head = 0; m_frames = 0; }
+
+    private:
+
+        char* FrameAt(size_t frame) { return m_data.get() + frame * m_frameSize; }
+
+        std::unique_ptr<char[], AlignedFreeDeleter> m_data;
+        uint32_t m_frameSize = 0;
+        size_t m_capacity = 0;
+
+        size_t m_head = 0;
+        size_t m_frames = 0;
+    };
+}
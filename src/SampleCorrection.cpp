@@ -1,134 +1,208 @@
-#include "pch.h"
-#include "SampleCorrection.h"
-
-namespace SaneAudioRenderer
-{
-    void SampleCorrection::NewFormat(SharedWaveFormat format)
-    {
-        assert(format);
-        assert(format->nSamplesPerSec > 0);
-
-        if (m_format)
-        {
-            m_segmentTimeInPreviousFormats += FramesToTime(m_segmentFramesInCurrentFormat);
-            m_segmentFramesInCurrentFormat = 0;
-        }
-
-        m_format = format;
-        m_bitstream = (DspFormatFromWaveFormat(*m_format) == DspFormat::Unknown);
-    }
-
-    void SampleCorrection::NewSegment(double rate)
-    {
-        assert(rate > 0.0);
-
-        m_rate = rate;
-
-        m_segmentTimeInPreviousFormats = 0;
-        m_segmentFramesInCurrentFormat = 0;
-
-        m_lastFrameEnd = 0;
-
-        m_timeDivergence = 0;
-    }
-
-    void SampleCorrection::NewDeviceBuffer()
-    {
-        m_freshBuffer = true;
-    }
-
-    DspChunk SampleCorrection::ProcessSample(IMediaSample* pSample, AM_SAMPLE2_PROPERTIES& sampleProps, bool realtimeDevice)
-    {
-        assert(m_format);
-
-        DspChunk chunk(pSample, sampleProps, *m_format);
-
-        if (m_bitstream)
-        {
-            if (m_freshBuffer && !(sampleProps.dwSampleFlags & AM_SAMPLE_SPLICEPOINT))
-            {
-                // Drop the sample.
-                DebugOut(ClassName(this), "drop [", sampleProps.tStart, sampleProps.tStop, "]");
-                chunk = DspChunk();
-                assert(chunk.IsEmpty());
-            }
-        }
-        else if (!realtimeDevice && (m_lastFrameEnd == 0 || (sampleProps.dwSampleFlags & AM_SAMPLE_TIMEDISCONTINUITY)))
-        {
-            if ((sampleProps.dwSampleFlags & AM_SAMPLE_STOPVALID) && sampleProps.tStop <= m_lastFrameEnd)
-            {
-                // Drop the sample.
-                DebugOut(ClassName(this), "drop [", sampleProps.tStart, sampleProps.tStop, "]");
-                chunk = DspChunk();
-                assert(chunk.IsEmpty());
-            }
-            else if ((sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID) && sampleProps.tStart < m_lastFrameEnd)
-            {
-                // Crop the sample.
-                const size_t cropFrames = (size_t)TimeToFrames(m_lastFrameEnd - sampleProps.tStart);
-
-                if (cropFrames > 0)
-                {
-                    DebugOut(ClassName(this), "crop", cropFrames, "frames from [",
-                             sampleProps.tStart, sampleProps.tStop, "]");
-
-                    chunk.ShrinkHead(chunk.GetFrameCount() > cropFrames ? chunk.GetFrameCount() - cropFrames : 0);
-
-                    sampleProps.tStart += FramesToTime(cropFrames);
-                }
-            }
-            else if ((sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID) && sampleProps.tStart > m_lastFrameEnd)
-            {
-                // Zero-pad the sample.
-                const size_t padFrames = (size_t)TimeToFrames(sampleProps.tStart - m_lastFrameEnd);
-
-                if (padFrames > 0 &&
-                    FramesToTime(padFrames) < 10 * OneSecond)
-                {
-                    DebugOut(ClassName(this), "pad", padFrames, "frames before [",
-                             sampleProps.tStart, sampleProps.tStop, "]");
-
-                    chunk.PadHead(padFrames);
-
-                    sampleProps.tStart -= FramesToTime(padFrames);
-                }
-            }
-        }
-
-        AccumulateTimings(sampleProps, chunk.GetFrameCount());
-
-        return chunk;
-    }
-
-    uint64_t SampleCorrection::TimeToFrames(REFERENCE_TIME time)
-    {
-        assert(m_format);
-        assert(m_rate > 0.0);
-        return (size_t)(llMulDiv(time, m_format->nSamplesPerSec, OneSecond, 0) * m_rate);
-    }
-
-    REFERENCE_TIME SampleCorrection::FramesToTime(uint64_t frames)
-    {
-        assert(m_format);
-        assert(m_rate > 0.0);
-        return (REFERENCE_TIME)(llMulDiv(frames, OneSecond, m_format->nSamplesPerSec, 0) / m_rate);
-    }
-
-    void SampleCorrection::AccumulateTimings(AM_SAMPLE2_PROPERTIES& sampleProps, size_t frames)
-    {
-        assert(m_format);
-        assert(m_rate > 0.0);
-
-        if (frames == 0)
-            return;
-
-        if (sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID)
-            m_timeDivergence = sampleProps.tStart - m_lastFrameEnd;
-
-        m_segmentFramesInCurrentFormat += frames;
-
-        m_lastFrameEnd = m_segmentTimeInPreviousFormats + FramesToTime(m_segmentFramesInCurrentFormat);
-
-        m_freshBuffer = false;
-    }
-}
+#include "pch.h"
+#include "SampleCorrection.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        std::pair<uint32_t, uint32_t> RateToFraction(double rate)
+        {
+            // Continued fraction expansion with bounded denominator,
+            // common rates like 24/23.976 (1001/1000) or 25/24 come out exact.
+            const uint64_t maxDenominator = 100000;
+
+            uint64_t p0 = 0, q0 = 1;
+            uint64_t p1 = 1, q1 = 0;
+            double x = rate;
+
+            for (int i = 0; i < 64; i++)
+            {
+                const double a = std::floor(x);
+                const uint64_t p2 = (uint64_t)a * p1 + p0;
+                const uint64_t q2 = (uint64_t)a * q1 + q0;
+
+                if (q2 > maxDenominator)
+                    break;
+
+                p0 = p1;
+                q0 = q1;
+                p1 = p2;
+                q1 = q2;
+
+                if (x - a < 1e-9)
+                    break;
+
+                x = 1.0 / (x - a);
+            }
+
+            return {(uint32_t)std::max<uint64_t>(p1, 1), (uint32_t)q1};
+        }
+    }
+
+    void SampleCorrection::NewFormat(SharedWaveFormat format)
+    {
+        assert(format);
+        assert(format->nSamplesPerSec > 0);
+
+        if (m_format)
+        {
+            uint32_t fraction;
+            m_segmentTimeInPreviousFormats += FramesToTime(m_segmentFramesInCurrentFormat, fraction);
+
+            const uint64_t fractionSum = (uint64_t)m_segmentTimeFraction + fraction;
+            m_segmentTimeInPreviousFormats += (REFERENCE_TIME)(fractionSum >> 32);
+            m_segmentTimeFraction = (uint32_t)fractionSum;
+
+            m_segmentFramesInCurrentFormat = 0;
+        }
+
+        m_format = format;
+        m_bitstream = (DspFormatFromWaveFormat(*m_format) == DspFormat::Unknown);
+    }
+
+    void SampleCorrection::NewSegment(double rate)
+    {
+        assert(rate > 0.0);
+
+        std::tie(m_rateNumerator, m_rateDenominator) = RateToFraction(rate);
+
+        m_segmentTimeInPreviousFormats = 0;
+        m_segmentTimeFraction = 0;
+        m_segmentFramesInCurrentFormat = 0;
+
+        m_lastFrameEnd = 0;
+
+        m_timeDivergence = 0;
+    }
+
+    void SampleCorrection::NewDeviceBuffer()
+    {
+        m_freshBuffer = true;
+    }
+
+    DspChunk SampleCorrection::ProcessSample(IMediaSample* pSample, AM_SAMPLE2_PROPERTIES& sampleProps, bool realtimeDevice)
+    {
+        assert(m_format);
+
+        DspChunk chunk(pSample, sampleProps, *m_format);
+
+        m_lastSampleCorrected = false;
+
+        if (m_bitstream)
+        {
+            if (m_freshBuffer && !(sampleProps.dwSampleFlags & AM_SAMPLE_SPLICEPOINT))
+            {
+                // Drop the sample.
+                DebugOut(ClassName(this), "drop [", sampleProps.tStart, sampleProps.tStop, "]");
+                chunk = DspChunk();
+                m_lastSampleCorrected = true;
+                assert(chunk.IsEmpty());
+            }
+        }
+        else if (!realtimeDevice && (m_lastFrameEnd == 0 || (sampleProps.dwSampleFlags & AM_SAMPLE_TIMEDISCONTINUITY)))
+        {
+            if ((sampleProps.dwSampleFlags & AM_SAMPLE_STOPVALID) && sampleProps.tStop <= m_lastFrameEnd)
+            {
+                // Drop the sample.
+                DebugOut(ClassName(this), "drop [", sampleProps.tStart, sampleProps.tStop, "]");
+                chunk = DspChunk();
+                m_lastSampleCorrected = true;
+                assert(chunk.IsEmpty());
+            }
+            else if ((sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID) && sampleProps.tStart < m_lastFrameEnd)
+            {
+                // Crop the sample.
+                const size_t cropFrames = (size_t)TimeToFrames(m_lastFrameEnd - sampleProps.tStart);
+
+                if (cropFrames > 0)
+                {
+                    DebugOut(ClassName(this), "crop", cropFrames, "frames from [",
+                             sampleProps.tStart, sampleProps.tStop, "]");
+
+                    chunk.ShrinkHead(chunk.GetFrameCount() > cropFrames ? chunk.GetFrameCount() - cropFrames : 0);
+
+                    sampleProps.tStart += FramesToTime(cropFrames);
+                    m_lastSampleCorrected = true;
+                }
+            }
+            else if ((sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID) && sampleProps.tStart > m_lastFrameEnd)
+            {
+                // Zero-pad the sample.
+                const size_t padFrames = (size_t)TimeToFrames(sampleProps.tStart - m_lastFrameEnd);
+
+                if (padFrames > 0 &&
+                    FramesToTime(padFrames) < 10 * OneSecond)
+                {
+                    DebugOut(ClassName(this), "pad", padFrames, "frames before [",
+                             sampleProps.tStart, sampleProps.tStop, "]");
+
+                    chunk.PadHead(padFrames);
+
+                    sampleProps.tStart -= FramesToTime(padFrames);
+                    m_lastSampleCorrected = true;
+                }
+            }
+        }
+
+        AccumulateTimings(sampleProps, chunk.GetFrameCount());
+
+        return chunk;
+    }
+
+    uint64_t SampleCorrection::TimeToFrames(REFERENCE_TIME time)
+    {
+        assert(m_format);
+        assert(time >= 0);
+
+        // Rounded to the nearest frame, half a frame of mismatch is all there is to correct.
+        const int64_t multiplier = (int64_t)m_format->nSamplesPerSec * m_rateNumerator;
+        const int64_t divisor = OneSecond * m_rateDenominator;
+
+        return (uint64_t)llMulDiv(time, multiplier, divisor, divisor / 2);
+    }
+
+    REFERENCE_TIME SampleCorrection::FramesToTime(uint64_t frames)
+    {
+        uint32_t fraction;
+        const REFERENCE_TIME time = FramesToTime(frames, fraction);
+
+        return time + (fraction >= 0x80000000 ? 1 : 0);
+    }
+
+    REFERENCE_TIME SampleCorrection::FramesToTime(uint64_t frames, uint32_t& fraction)
+    {
+        assert(m_format);
+
+        const int64_t multiplier = OneSecond * m_rateDenominator;
+        const int64_t divisor = (int64_t)m_format->nSamplesPerSec * m_rateNumerator;
+
+        const REFERENCE_TIME time = llMulDiv(frames, multiplier, divisor, 0);
+
+        // The remainder is smaller than the divisor, wrapping 64-bit arithmetic recovers it exactly.
+        const uint64_t remainder = frames * (uint64_t)multiplier - (uint64_t)time * (uint64_t)divisor;
+        fraction = (uint32_t)llMulDiv(remainder, 1ll << 32, divisor, 0);
+
+        return time;
+    }
+
+    void SampleCorrection::AccumulateTimings(AM_SAMPLE2_PROPERTIES& sampleProps, size_t frames)
+    {
+        assert(m_format);
+
+        if (frames == 0)
+            return;
+
+        if (sampleProps.dwSampleFlags & AM_SAMPLE_TIMEVALID)
+            m_timeDivergence = sampleProps.tStart - m_lastFrameEnd;
+
+        m_segmentFramesInCurrentFormat += frames;
+
+        uint32_t fraction;
+        const REFERENCE_TIME time = FramesToTime(m_segmentFramesInCurrentFormat, fraction);
+        const uint64_t fractionSum = (uint64_t)m_segmentTimeFraction + fraction;
+
+        m_lastFrameEnd = m_segmentTimeInPreviousFormats + time + (REFERENCE_TIME)((fractionSum + 0x80000000) >> 32);
+
+        m_freshBuffer = false;
+    }
+}
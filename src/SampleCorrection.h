@@ -1,43 +1,51 @@
-#pragma once
-
-#include "DspChunk.h"
-
-namespace SaneAudioRenderer
-{
-    class SampleCorrection final
-    {
-    public:
-
-        SampleCorrection() = default;
-
-        void NewFormat(SharedWaveFormat format);
-        void NewSegment(double rate);
-        void NewDeviceBuffer();
-
-        DspChunk ProcessSample(IMediaSample* pSample, AM_SAMPLE2_PROPERTIES& sampleProps, bool realtimeDevice);
-
-        REFERENCE_TIME GetLastFrameEnd()   const { return m_lastFrameEnd; }
-        REFERENCE_TIME GetTimeDivergence() const { return m_timeDivergence; }
-
-    private:
-
-        void AccumulateTimings(AM_SAMPLE2_PROPERTIES& sampleProps, size_t frames);
-
-        uint64_t TimeToFrames(REFERENCE_TIME time);
-        REFERENCE_TIME FramesToTime(uint64_t frames);
-
-        SharedWaveFormat m_format;
-        bool m_bitstream = false;
-
-        double m_rate = 1.0;
-
-        REFERENCE_TIME m_segmentTimeInPreviousFormats = 0;
-        uint64_t m_segmentFramesInCurrentFormat = 0;
-
-        REFERENCE_TIME m_lastFrameEnd = 0;
-
-        REFERENCE_TIME m_timeDivergence = 0;
-
-        bool m_freshBuffer = true;
-    };
-}
+#pragma once
+
+#include "DspChunk.h"
+
+namespace SaneAudioRenderer
+{
+    class SampleCorrection final
+    {
+    public:
+
+        SampleCorrection() = default;
+
+        void NewFormat(SharedWaveFormat format);
+        void NewSegment(double rate);
+        void NewDeviceBuffer();
+
+        DspChunk ProcessSample(IMediaSample* pSample, AM_SAMPLE2_PROPERTIES& sampleProps, bool realtimeDevice);
+
+        REFERENCE_TIME GetLastFrameEnd()   const { return m_lastFrameEnd; }
+        REFERENCE_TIME GetTimeDivergence() const { return m_timeDivergence; }
+
+        bool IsLastSampleCorrected() const { return m_lastSampleCorrected; }
+
+    private:
+
+        void AccumulateTimings(AM_SAMPLE2_PROPERTIES& sampleProps, size_t frames);
+
+        uint64_t TimeToFrames(REFERENCE_TIME time);
+        REFERENCE_TIME FramesToTime(uint64_t frames);
+        REFERENCE_TIME FramesToTime(uint64_t frames, uint32_t& fraction);
+
+        SharedWaveFormat m_format;
+        bool m_bitstream = false;
+
+        // Segment rate as an exact fraction, so time and frame conversions don't drift.
+        uint32_t m_rateNumerator = 1;
+        uint32_t m_rateDenominator = 1;
+
+        REFERENCE_TIME m_segmentTimeInPreviousFormats = 0;
+        uint32_t m_segmentTimeFraction = 0; // Carried sub-tick remainder, in 1/2^32 ticks.
+        uint64_t m_segmentFramesInCurrentFormat = 0;
+
+        REFERENCE_TIME m_lastFrameEnd = 0;
+
+        REFERENCE_TIME m_timeDivergence = 0;
+
+        bool m_freshBuffer = true;
+
+        bool m_lastSampleCorrected = false; // Dropped, cropped or padded.
+    };
+}
@@ -1,195 +1,342 @@
-#include "pch.h"
-#include "Settings.h"
-
-namespace SaneAudioRenderer
-{
-    Settings::Settings(IUnknown* pUnknown)
-        : CUnknown("Audio Renderer Settings", pUnknown)
-    {
-    }
-
-    STDMETHODIMP Settings::NonDelegatingQueryInterface(REFIID riid, void** ppv)
-    {
-        return (riid == __uuidof(ISettings)) ?
-                   GetInterface(static_cast<ISettings*>(this), ppv) :
-                   CUnknown::NonDelegatingQueryInterface(riid, ppv);
-    }
-
-    STDMETHODIMP_(UINT32) Settings::GetSerial()
-    {
-        return m_serial;
-    }
-
-    STDMETHODIMP Settings::SetOuputDevice(LPCWSTR pDeviceId, BOOL bExclusive, UINT32 uBufferMS)
-    {
-        if (uBufferMS < OUTPUT_DEVICE_BUFFER_MIN_MS || uBufferMS > OUTPUT_DEVICE_BUFFER_MAX_MS)
-            return E_INVALIDARG;
-
-        CAutoLock lock(this);
-
-        if (m_exclusive != bExclusive ||
-            m_buffer != uBufferMS ||
-            (pDeviceId && m_deviceId != pDeviceId) ||
-            (!pDeviceId && !m_deviceId.empty()))
-        {
-            try
-            {
-                m_deviceId = pDeviceId ? pDeviceId : L"";
-                m_exclusive = bExclusive;
-                m_buffer = uBufferMS;
-                m_serial++;
-            }
-            catch (std::bad_alloc&)
-            {
-                return E_OUTOFMEMORY;
-            }
-        }
-
-        return S_OK;
-    }
-
-    STDMETHODIMP Settings::GetOuputDevice(LPWSTR* ppDeviceId, BOOL* pbExclusive, UINT32* puBufferMS)
-    {
-        CAutoLock lock(this);
-
-        if (pbExclusive)
-            *pbExclusive = m_exclusive;
-
-        if (ppDeviceId)
-        {
-            size_t size = sizeof(wchar_t) * (m_deviceId.length() + 1);
-
-            *ppDeviceId = static_cast<LPWSTR>(CoTaskMemAlloc(size));
-
-            if (!*ppDeviceId)
-                return E_OUTOFMEMORY;
-
-            memcpy(*ppDeviceId, m_deviceId.c_str(), size);
-        }
-
-        if (puBufferMS)
-            *puBufferMS = m_buffer;
-
-        return S_OK;
-    }
-
-    STDMETHODIMP_(void) Settings::SetAllowBitstreaming(BOOL bAllowBitstreaming)
-    {
-        CAutoLock lock(this);
-
-        if (m_allowBitstreaming != bAllowBitstreaming)
-        {
-            m_allowBitstreaming = bAllowBitstreaming;
-            m_serial++;
-        }
-    }
-
-    STDMETHODIMP_(BOOL) Settings::GetAllowBitstreaming()
-    {
-        CAutoLock lock(this);
-
-        return m_allowBitstreaming;
-    }
-
-    STDMETHODIMP_(void) Settings::SetCrossfeedEnabled(BOOL bEnable)
-    {
-        CAutoLock lock(this);
-
-        if (m_crossfeedEnabled != bEnable)
-        {
-            m_crossfeedEnabled = bEnable;
-            m_serial++;
-        }
-    }
-
-    STDMETHODIMP_(BOOL) Settings::GetCrossfeedEnabled()
-    {
-        CAutoLock lock(this);
-
-        return m_crossfeedEnabled;
-    }
-
-    STDMETHODIMP Settings::SetCrossfeedSettings(UINT32 uCutoffFrequency, UINT32 uCrossfeedLevel)
-    {
-        if (uCutoffFrequency < CROSSFEED_CUTOFF_FREQ_MIN ||
-            uCutoffFrequency > CROSSFEED_CUTOFF_FREQ_MAX ||
-            uCrossfeedLevel < CROSSFEED_LEVEL_MIN ||
-            uCrossfeedLevel > CROSSFEED_LEVEL_MAX)
-        {
-            return E_INVALIDARG;
-        }
-
-        CAutoLock lock(this);
-
-        if (m_crossfeedCutoffFrequency != uCutoffFrequency ||
-            m_crossfeedLevel != uCrossfeedLevel)
-        {
-            m_crossfeedCutoffFrequency = uCutoffFrequency;
-            m_crossfeedLevel = uCrossfeedLevel;
-            m_serial++;
-        }
-
-        return S_OK;
-    }
-
-    STDMETHODIMP_(void) Settings::GetCrossfeedSettings(UINT32* puCutoffFrequency, UINT32* puCrossfeedLevel)
-    {
-        CAutoLock lock(this);
-
-        if (puCutoffFrequency)
-            *puCutoffFrequency = m_crossfeedCutoffFrequency;
-
-        if (puCrossfeedLevel)
-            *puCrossfeedLevel = m_crossfeedLevel;
-    }
-
-    STDMETHODIMP_(void) Settings::SetIgnoreSystemChannelMixer(BOOL bEnable)
-    {
-        CAutoLock lock(this);
-
-        if (m_ignoreSystemChannelMixer != bEnable)
-        {
-            m_ignoreSystemChannelMixer = bEnable;
-            m_serial++;
-        }
-    }
-
-    STDMETHODIMP_(BOOL) Settings::GetIgnoreSystemChannelMixer()
-    {
-        CAutoLock lock(this);
-
-        return m_ignoreSystemChannelMixer;
-    }
-
-    STDMETHODIMP Settings::SetTimestretchSettings(UINT32 uTimestretchMethod)
-    {
-        if (uTimestretchMethod != TIMESTRETCH_METHOD_SOLA &&
-            uTimestretchMethod != TIMESTRETCH_METHOD_PHASE_VOCODER)
-        {
-            return E_INVALIDARG;
-        }
-
-    #ifndef SANEAR_GPL_PHASE_VOCODER
-        if (uTimestretchMethod == TIMESTRETCH_METHOD_PHASE_VOCODER)
-            return E_NOTIMPL;
-    #endif
-
-        CAutoLock lock(this);
-
-        if (uTimestretchMethod != m_timestretchMethod)
-        {
-            m_timestretchMethod = uTimestretchMethod;
-            m_serial++;
-        }
-
-        return S_OK;
-    }
-
-    STDMETHODIMP_(void) Settings::GetTimestretchSettings(UINT32* puTimestretchMethod)
-    {
-        CAutoLock lock(this);
-
-        if (puTimestretchMethod)
-            *puTimestretchMethod = m_timestretchMethod;
-    }
-}
+#include "pch.h"
+#include "Settings.h"
+
+namespace SaneAudioRenderer
+{
+    Settings::Settings(IUnknown* pUnknown)
+        : CUnknown("Audio Renderer Settings", pUnknown)
+    {
+    }
+
+    STDMETHODIMP Settings::NonDelegatingQueryInterface(REFIID riid, void** ppv)
+    {
+        return (riid == __uuidof(ISettings)) ?
+                   GetInterface(static_cast<ISettings*>(this), ppv) :
+                   CUnknown::NonDelegatingQueryInterface(riid, ppv);
+    }
+
+    STDMETHODIMP_(UINT32) Settings::GetSerial()
+    {
+        return m_serial;
+    }
+
+    STDMETHODIMP Settings::SetOuputDevice(LPCWSTR pDeviceId, BOOL bExclusive, UINT32 uBufferMS)
+    {
+        if (uBufferMS < OUTPUT_DEVICE_BUFFER_MIN_MS || uBufferMS > OUTPUT_DEVICE_BUFFER_MAX_MS)
+            return E_INVALIDARG;
+
+        ProfiledLock(lock, this);
+
+        if (m_exclusive != bExclusive ||
+            m_buffer != uBufferMS ||
+            (pDeviceId && m_deviceId != pDeviceId) ||
+            (!pDeviceId && !m_deviceId.empty()))
+        {
+            try
+            {
+                m_deviceId = pDeviceId ? pDeviceId : L"";
+                m_exclusive = bExclusive;
+                m_buffer = uBufferMS;
+                m_serial++;
+            }
+            catch (std::bad_alloc&)
+            {
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP Settings::GetOuputDevice(LPWSTR* ppDeviceId, BOOL* pbExclusive, UINT32* puBufferMS)
+    {
+        ProfiledLock(lock, this);
+
+        if (pbExclusive)
+            *pbExclusive = m_exclusive;
+
+        if (ppDeviceId)
+        {
+            size_t size = sizeof(wchar_t) * (m_deviceId.length() + 1);
+
+            *ppDeviceId = static_cast<LPWSTR>(CoTaskMemAlloc(size));
+
+            if (!*ppDeviceId)
+                return E_OUTOFMEMORY;
+
+            memcpy(*ppDeviceId, m_deviceId.c_str(), size);
+        }
+
+        if (puBufferMS)
+            *puBufferMS = m_buffer;
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(void) Settings::SetAllowBitstreaming(BOOL bAllowBitstreaming)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_allowBitstreaming != bAllowBitstreaming)
+        {
+            m_allowBitstreaming = bAllowBitstreaming;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetAllowBitstreaming()
+    {
+        ProfiledLock(lock, this);
+
+        return m_allowBitstreaming;
+    }
+
+    STDMETHODIMP_(void) Settings::SetCrossfeedEnabled(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_crossfeedEnabled != bEnable)
+        {
+            m_crossfeedEnabled = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetCrossfeedEnabled()
+    {
+        ProfiledLock(lock, this);
+
+        return m_crossfeedEnabled;
+    }
+
+    STDMETHODIMP Settings::SetCrossfeedSettings(UINT32 uCutoffFrequency, UINT32 uCrossfeedLevel)
+    {
+        if (uCutoffFrequency < CROSSFEED_CUTOFF_FREQ_MIN ||
+            uCutoffFrequency > CROSSFEED_CUTOFF_FREQ_MAX ||
+            uCrossfeedLevel < CROSSFEED_LEVEL_MIN ||
+            uCrossfeedLevel > CROSSFEED_LEVEL_MAX)
+        {
+            return E_INVALIDARG;
+        }
+
+        ProfiledLock(lock, this);
+
+        if (m_crossfeedCutoffFrequency != uCutoffFrequency ||
+            m_crossfeedLevel != uCrossfeedLevel)
+        {
+            m_crossfeedCutoffFrequency = uCutoffFrequency;
+            m_crossfeedLevel = uCrossfeedLevel;
+            m_serial++;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(void) Settings::GetCrossfeedSettings(UINT32* puCutoffFrequency, UINT32* puCrossfeedLevel)
+    {
+        ProfiledLock(lock, this);
+
+        if (puCutoffFrequency)
+            *puCutoffFrequency = m_crossfeedCutoffFrequency;
+
+        if (puCrossfeedLevel)
+            *puCrossfeedLevel = m_crossfeedLevel;
+    }
+
+    STDMETHODIMP_(void) Settings::SetIgnoreSystemChannelMixer(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_ignoreSystemChannelMixer != bEnable)
+        {
+            m_ignoreSystemChannelMixer = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetIgnoreSystemChannelMixer()
+    {
+        ProfiledLock(lock, this);
+
+        return m_ignoreSystemChannelMixer;
+    }
+
+    STDMETHODIMP Settings::SetTimestretchSettings(UINT32 uTimestretchMethod)
+    {
+        if (uTimestretchMethod != TIMESTRETCH_METHOD_SOLA &&
+            uTimestretchMethod != TIMESTRETCH_METHOD_PHASE_VOCODER &&
+            uTimestretchMethod != TIMESTRETCH_METHOD_RESAMPLE)
+        {
+            return E_INVALIDARG;
+        }
+
+    #ifndef SANEAR_GPL_PHASE_VOCODER
+        if (uTimestretchMethod == TIMESTRETCH_METHOD_PHASE_VOCODER)
+            return E_NOTIMPL;
+    #endif
+
+        ProfiledLock(lock, this);
+
+        if (uTimestretchMethod != m_timestretchMethod)
+        {
+            m_timestretchMethod = uTimestretchMethod;
+            m_serial++;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(void) Settings::GetTimestretchSettings(UINT32* puTimestretchMethod)
+    {
+        ProfiledLock(lock, this);
+
+        if (puTimestretchMethod)
+            *puTimestretchMethod = m_timestretchMethod;
+    }
+
+    STDMETHODIMP Settings::SetDeepBufferSettings(UINT32 uDeepBufferMS)
+    {
+        if (uDeepBufferMS != DEEP_BUFFER_DISABLED &&
+            (uDeepBufferMS < DEEP_BUFFER_MIN_MS || uDeepBufferMS > DEEP_BUFFER_MAX_MS))
+        {
+            return E_INVALIDARG;
+        }
+
+        ProfiledLock(lock, this);
+
+        if (m_deepBuffer != uDeepBufferMS)
+        {
+            m_deepBuffer = uDeepBufferMS;
+            m_serial++;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(void) Settings::GetDeepBufferSettings(UINT32* puDeepBufferMS)
+    {
+        ProfiledLock(lock, this);
+
+        if (puDeepBufferMS)
+            *puDeepBufferMS = m_deepBuffer;
+    }
+
+    STDMETHODIMP_(void) Settings::SetMultithreadedResampling(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_multithreadedResampling != bEnable)
+        {
+            m_multithreadedResampling = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetMultithreadedResampling()
+    {
+        ProfiledLock(lock, this);
+
+        return m_multithreadedResampling;
+    }
+
+    STDMETHODIMP_(void) Settings::SetCompressorEnabled(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_compressorEnabled != bEnable)
+        {
+            m_compressorEnabled = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetCompressorEnabled()
+    {
+        ProfiledLock(lock, this);
+
+        return m_compressorEnabled;
+    }
+
+    STDMETHODIMP Settings::SetMatrixHeadroomSettings(UINT32 uHeadroomMode)
+    {
+        if (uHeadroomMode != MATRIX_HEADROOM_OFF &&
+            uHeadroomMode != MATRIX_HEADROOM_NORMALIZE &&
+            uHeadroomMode != MATRIX_HEADROOM_MAKEUP)
+        {
+            return E_INVALIDARG;
+        }
+
+        ProfiledLock(lock, this);
+
+        if (m_matrixHeadroom != uHeadroomMode)
+        {
+            m_matrixHeadroom = uHeadroomMode;
+            m_serial++;
+        }
+
+        return S_OK;
+    }
+
+    STDMETHODIMP_(void) Settings::GetMatrixHeadroomSettings(UINT32* puHeadroomMode)
+    {
+        ProfiledLock(lock, this);
+
+        if (puHeadroomMode)
+            *puHeadroomMode = m_matrixHeadroom;
+    }
+
+    STDMETHODIMP_(void) Settings::SetSharedClockDomain(UINT32 uDomain)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_sharedClockDomain != uDomain)
+        {
+            m_sharedClockDomain = uDomain;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(void) Settings::GetSharedClockDomain(UINT32* puDomain)
+    {
+        ProfiledLock(lock, this);
+
+        if (puDomain)
+            *puDomain = m_sharedClockDomain;
+    }
+
+    STDMETHODIMP_(void) Settings::SetBitPerfectVerification(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_bitPerfectVerification != bEnable)
+        {
+            m_bitPerfectVerification = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetBitPerfectVerification()
+    {
+        ProfiledLock(lock, this);
+
+        return m_bitPerfectVerification;
+    }
+
+    STDMETHODIMP_(void) Settings::SetGlitchDetection(BOOL bEnable)
+    {
+        ProfiledLock(lock, this);
+
+        if (m_glitchDetection != bEnable)
+        {
+            m_glitchDetection = bEnable;
+            m_serial++;
+        }
+    }
+
+    STDMETHODIMP_(BOOL) Settings::GetGlitchDetection()
+    {
+        ProfiledLock(lock, this);
+
+        return m_glitchDetection;
+    }
+}
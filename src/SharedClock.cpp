@@ -0,0 +1,180 @@
+#include "pch.h"
+#include "SharedClock.h"
+
+namespace SaneAudioRenderer
+{
+    namespace
+    {
+        bool IsProcessAlive(DWORD processId)
+        {
+            HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, processId);
+
+            if (process == NULL)
+                return false;
+
+            const bool alive = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+            CloseHandle(process);
+
+            return alive;
+        }
+    }
+
+    SharedClock::~SharedClock()
+    {
+        Leave();
+    }
+
+    void SharedClock::Join(UINT32 domain)
+    {
+        Leave();
+
+        if (domain == 0)
+            return;
+
+        std::array<wchar_t, 64> name;
+        if (swprintf(name.data(), name.size(), L"Local\\SaneAudioRenderer.SharedClock.%u", domain) < 0)
+            return;
+
+        m_mapping = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Shared), name.data());
+
+        if (m_mapping == NULL)
+        {
+            DebugOut(ClassName(this), "failed to create mapping for domain", domain);
+            return;
+        }
+
+        m_pShared = static_cast<Shared*>(MapViewOfFile(m_mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(Shared)));
+
+        if (!m_pShared)
+        {
+            DebugOut(ClassName(this), "failed to map domain", domain);
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+            return;
+        }
+
+        m_domain = domain;
+
+        // Fresh mappings are zeroed, so an empty master slot is zero. Take it over from a crashed master too.
+        const DWORD processId = GetCurrentProcessId();
+        uint32_t masterProcess = m_pShared->masterProcess;
+
+        if (masterProcess != 0 && !IsProcessAlive(masterProcess))
+            m_pShared->masterProcess.compare_exchange_strong(masterProcess, 0);
+
+        masterProcess = 0;
+        m_master = m_pShared->masterProcess.compare_exchange_strong(masterProcess, processId);
+
+        if (m_master)
+        {
+            // A master that died in the middle of an update leaves the sequence odd, get it back to even
+            // or every following update would look torn to the readers.
+            const uint32_t sequence = m_pShared->sequence.load(std::memory_order_relaxed);
+
+            if (sequence & 1)
+                m_pShared->sequence.store(sequence + 1, std::memory_order_release);
+
+            Write(0, GetCounterTime(), false);
+        }
+
+        DebugOut(ClassName(this), "joined domain", domain, m_master ? "as master" : "as follower");
+    }
+
+    void SharedClock::Leave()
+    {
+        if (m_pShared)
+        {
+            if (m_master)
+            {
+                Write(0, GetCounterTime(), false);
+                m_pShared->masterProcess = 0;
+            }
+
+            UnmapViewOfFile(m_pShared);
+            m_pShared = nullptr;
+        }
+
+        if (m_mapping != NULL)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+
+        m_domain = 0;
+        m_master = false;
+    }
+
+    void SharedClock::Publish(REFERENCE_TIME streamTime)
+    {
+        if (IsMaster())
+            Write(streamTime, GetCounterTime(), true);
+    }
+
+    void SharedClock::Pause()
+    {
+        if (IsMaster())
+            Write(0, GetCounterTime(), false);
+    }
+
+    bool SharedClock::GetStreamTime(REFERENCE_TIME& streamTime)
+    {
+        if (!IsFollower())
+            return false;
+
+        // Bounded, the master can die in the middle of an update and the caller holds the object lock.
+        // Not getting a consistent read is treated as the domain not running.
+        for (size_t i = 0; i < 256; i++)
+        {
+            const uint32_t sequence = m_pShared->sequence.load(std::memory_order_acquire);
+
+            // Odd sequence means the master is in the middle of an update.
+            if (sequence & 1)
+            {
+                YieldProcessor();
+                continue;
+            }
+
+            const bool running = m_pShared->running.load(std::memory_order_relaxed) &&
+                                 m_pShared->masterProcess.load(std::memory_order_relaxed) != 0;
+            const REFERENCE_TIME publishedStreamTime = m_pShared->streamTime.load(std::memory_order_relaxed);
+            const int64_t publishedCounterTime = m_pShared->counterTime.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (m_pShared->sequence.load(std::memory_order_relaxed) != sequence)
+                continue;
+
+            if (!running)
+                return false;
+
+            streamTime = publishedStreamTime + GetCounterTime() - publishedCounterTime;
+            return true;
+        }
+
+        DebugOut(ClassName(this), "inconsistent shared state in domain", m_domain);
+
+        return false;
+    }
+
+    int64_t SharedClock::GetCounterTime()
+    {
+        return llMulDiv(GetPerformanceCounter(), OneSecond, GetPerformanceFrequency(), 0);
+    }
+
+    void SharedClock::Write(REFERENCE_TIME streamTime, int64_t counterTime, bool running)
+    {
+        assert(m_pShared);
+        assert(m_master);
+
+        const uint32_t sequence = m_pShared->sequence.load(std::memory_order_relaxed);
+
+        m_pShared->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_pShared->streamTime.store(streamTime, std::memory_order_relaxed);
+        m_pShared->counterTime.store(counterTime, std::memory_order_relaxed);
+        m_pShared->running.store(running, std::memory_order_relaxed);
+
+        m_pShared->sequence.store(sequence + 2, std::memory_order_release);
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace SaneAudioRenderer
+{
+    // Clock domain shared by renderers in different processes through a named file mapping.
+    // The first instance to join publishes how far its stream has played, the others follow it
+    // with their clock matching. Performance counter is system wide, so the published points
+    // can be compared across processes. Readers never block the publisher (sequence lock).
+    class SharedClock final
+    {
+    public:
+
+        SharedClock() = default;
+        SharedClock(const SharedClock&) = delete;
+        SharedClock& operator=(const SharedClock&) = delete;
+        ~SharedClock();
+
+        void Join(UINT32 domain);
+        void Leave();
+
+        UINT32 GetDomain() const { return m_domain; }
+        bool IsMaster() const    { return m_pShared && m_master; }
+        bool IsFollower() const  { return m_pShared && !m_master; }
+
+        // Master side, streamTime is the graph time since Run().
+        void Publish(REFERENCE_TIME streamTime);
+        void Pause();
+
+        // Follower side, extrapolates the last published point to now.
+        bool GetStreamTime(REFERENCE_TIME& streamTime);
+
+        static int64_t GetCounterTime();
+
+    private:
+
+        struct Shared
+        {
+            std::atomic<uint32_t> sequence;
+            std::atomic<uint32_t> masterProcess;
+            std::atomic<int64_t> streamTime;
+            std::atomic<int64_t> counterTime;
+            std::atomic<uint32_t> running;
+        };
+
+        void Write(REFERENCE_TIME streamTime, int64_t counterTime, bool running);
+
+        UINT32 m_domain = 0;
+        HANDLE m_mapping = NULL;
+        Shared* m_pShared = nullptr;
+        bool m_master = false;
+    };
+}